@@ -1,6 +1,7 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
@@ -20,11 +21,22 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* Sleeping threads, hashed into a timing wheel by wakeup tick.
+   A thread that wakes up at tick T lives in bucket
+   T % SLEEP_WHEEL_SIZE, and each bucket is kept sorted by
+   wakeup tick.  Thus, the timer interrupt only needs to look at
+   the front of a single bucket on each tick, and only threads
+   that actually wake up are ever removed. */
+#define SLEEP_WHEEL_SIZE 64             /* Must be a power of 2. */
+static struct list sleep_wheel[SLEEP_WHEEL_SIZE];
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
 static intr_handler_func timer_interrupt;
+static struct list *sleep_bucket (int64_t tick);
+static list_less_func wakeup_less;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
@@ -35,6 +47,11 @@ static void real_time_delay (int64_t num, int32_t denom);
 void
 timer_init (void) 
 {
+  size_t i;
+
+  for (i = 0; i < SLEEP_WHEEL_SIZE; i++)
+    list_init (&sleep_wheel[i]);
+
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -85,15 +102,34 @@ timer_elapsed (int64_t then)
 }
 
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.
+
+   The calling thread is blocked, not spun, and is woken up by
+   the timer interrupt handler once its wakeup tick arrives, or
+   earlier by timer_wake().  Signals that arrive meanwhile are
+   delivered when it wakes. */
 void
 timer_sleep (int64_t ticks) 
 {
-  int64_t start = timer_ticks ();
+  int64_t wakeup = timer_ticks () + ticks;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
+
+  /* Check the deadline again with interrupts off, so that a tick
+     cannot slip by between the check and the insertion. */
+  old_level = intr_disable ();
+  if (wakeup > timer_ticks ())
+    {
+      cur->wakeup_tick = wakeup;
+      list_insert_ordered (sleep_bucket (wakeup), &cur->elem,
+                           wakeup_less, NULL);
+      thread_block ();
+    }
+  intr_set_level (old_level);
+
+  signal_dispatch ();
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -170,10 +206,64 @@ timer_print_stats (void)
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
+  struct list *bucket;
+
   ticks++;
+
+  /* Wake up the threads whose time has come.  They are at the
+     front of this tick's bucket; the rest of the bucket belongs
+     to later turns of the wheel. */
+  bucket = sleep_bucket (ticks);
+  while (!list_empty (bucket))
+    {
+      struct thread *t = list_entry (list_front (bucket),
+                                     struct thread, elem);
+      if (t->wakeup_tick > ticks)
+        break;
+      list_pop_front (bucket);
+      t->wakeup_tick = 0;
+      thread_unblock (t);
+    }
+
   thread_tick ();
 }
 
+/* Wakes up thread T early if it is asleep in timer_sleep(),
+   taking it out of the timing wheel.  Returns true if T was
+   asleep, false otherwise.  Interrupts must be off. */
+bool
+timer_wake (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->status != THREAD_BLOCKED || t->wakeup_tick == 0)
+    return false;
+  list_remove (&t->elem);
+  t->wakeup_tick = 0;
+  thread_unblock (t);
+  return true;
+}
+
+/* Returns the timing wheel bucket for threads that wake up at
+   TICK. */
+static struct list *
+sleep_bucket (int64_t tick) 
+{
+  return &sleep_wheel[tick & (SLEEP_WHEEL_SIZE - 1)];
+}
+
+/* Returns true if thread A wakes up before thread B, false
+   otherwise.  Threads with equal wakeup ticks keep FIFO order. */
+static bool
+wakeup_less (const struct list_elem *a_, const struct list_elem *b_,
+             void *aux UNUSED) 
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->wakeup_tick < b->wakeup_tick;
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
@@ -0,0 +1,316 @@
+#include "filesys/cache.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "devices/timer.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Buffer cache.
+
+   Every access to a sector of the file system device, whether
+   to file data, to an inode, to a directory, or to the free map,
+   goes through a cache of CACHE_CNT sectors.  A sector that is
+   not cached replaces one chosen by the clock algorithm, which
+   writes it back first if it was modified.  Modified sectors
+   are otherwise written back only by cache_flush(), which a
+   kernel thread calls every FLUSH_MS milliseconds and which the
+   file system calls at shutdown.  Another kernel thread reads in
+   sectors that cache_readahead() predicts will be wanted soon.
+
+   Each entry has a lock that is held while it is being read or
+   written, by the cache or by its user, so that an entry can be
+   copied into or out of without holding up the rest of the
+   cache.  cache_lock protects the assignment of sectors to
+   entries and the clock hand.  An entry's SECTOR changes only
+   with both locks held, so either is enough to read it.  A thread
+   holding cache_lock may try to lock entries, but never waits for
+   them, so a thread holding an entry's lock may wait for
+   cache_lock without risk of deadlock.  In particular, a dirty
+   entry chosen for eviction is written back with only its own
+   lock held. */
+#define CACHE_CNT 64
+#define FLUSH_MS 5000
+#define READAHEAD_CNT 16
+
+/* Marks an entry that holds no sector. */
+#define NO_SECTOR ((block_sector_t) -1)
+
+/* A cached sector. */
+struct cache_entry
+  {
+    struct lock lock;                   /* Held while in use. */
+    block_sector_t sector;              /* Sector held, or NO_SECTOR. */
+    bool dirty;                         /* Modified since written back? */
+    bool accessed;                      /* Used since the hand passed? */
+    uint8_t data[BLOCK_SECTOR_SIZE];    /* Sector contents. */
+  };
+
+static struct cache_entry cache[CACHE_CNT];
+static struct lock cache_lock;
+static size_t hand;
+
+/* Sectors to read ahead, in a circular queue. */
+static block_sector_t readahead_queue[READAHEAD_CNT];
+static size_t readahead_head, readahead_cnt;
+static struct lock readahead_lock;
+static struct condition readahead_cond;
+
+/* Statistics.  Sectors read ahead count as neither hits nor
+   misses, but a later access to one counts as a hit. */
+static long long hit_cnt, miss_cnt, readahead_read_cnt;
+
+static thread_func flush_daemon NO_RETURN;
+static thread_func readahead_daemon NO_RETURN;
+
+/* Initializes the buffer cache and starts its kernel threads. */
+void
+cache_init (void) 
+{
+  size_t i;
+
+  lock_init (&cache_lock);
+  for (i = 0; i < CACHE_CNT; i++)
+    {
+      lock_init (&cache[i].lock);
+      cache[i].sector = NO_SECTOR;
+      cache[i].dirty = false;
+      cache[i].accessed = false;
+    }
+  lock_init (&readahead_lock);
+  cond_init (&readahead_cond);
+
+  thread_create ("cache-flush", PRI_DEFAULT, flush_daemon, NULL);
+  thread_create ("cache-readahead", PRI_DEFAULT, readahead_daemon, NULL);
+}
+
+/* Writes every modified cached sector back to disk. */
+void
+cache_flush (void) 
+{
+  size_t i;
+
+  for (i = 0; i < CACHE_CNT; i++)
+    {
+      struct cache_entry *e = &cache[i];
+
+      lock_acquire (&e->lock);
+      if (e->sector != NO_SECTOR && e->dirty)
+        {
+          block_write (fs_device, e->sector, e->data);
+          e->dirty = false;
+        }
+      lock_release (&e->lock);
+    }
+}
+
+/* Prints buffer cache statistics. */
+void
+cache_print_stats (void) 
+{
+  printf ("Cache: %lld hits, %lld misses, %lld sectors read ahead\n",
+          hit_cnt, miss_cnt, readahead_read_cnt);
+}
+
+/* Returns the entry holding SECTOR, or a null pointer if SECTOR
+   is not cached.  cache_lock must be held. */
+static struct cache_entry *
+lookup (block_sector_t sector) 
+{
+  size_t i;
+
+  for (i = 0; i < CACHE_CNT; i++)
+    if (cache[i].sector == sector)
+      return &cache[i];
+  return NULL;
+}
+
+/* Chooses an entry to hold a new sector by the clock algorithm,
+   locks it, and returns it, or returns a null pointer if every
+   entry is locked.  cache_lock must be held. */
+static struct cache_entry *
+evict (void) 
+{
+  size_t i;
+
+  for (i = 0; i < CACHE_CNT * 2; i++)
+    {
+      struct cache_entry *e = &cache[hand];
+      if (++hand >= CACHE_CNT)
+        hand = 0;
+
+      if (!lock_try_acquire (&e->lock))
+        continue;
+      if (e->sector == NO_SECTOR || !e->accessed)
+        return e;
+      e->accessed = false;
+      lock_release (&e->lock);
+    }
+  return NULL;
+}
+
+/* Returns the entry for SECTOR, locked, caching it if it is not
+   cached already.  The sector is read from disk only if FILL is
+   true; otherwise the caller must overwrite all of it.  Sets
+   *HIT to whether SECTOR was cached already. */
+static struct cache_entry *
+lock_entry (block_sector_t sector, bool fill, bool *hit) 
+{
+  ASSERT (sector != NO_SECTOR);
+
+  for (;;)
+    {
+      struct cache_entry *e;
+
+      lock_acquire (&cache_lock);
+      e = lookup (sector);
+      if (e != NULL)
+        {
+          lock_release (&cache_lock);
+          lock_acquire (&e->lock);
+          if (e->sector != sector)
+            {
+              /* Evicted while we waited for it. */
+              lock_release (&e->lock);
+              continue;
+            }
+          e->accessed = true;
+          *hit = true;
+          return e;
+        }
+
+      e = evict ();
+      if (e == NULL)
+        {
+          /* Every entry is in use.  Let their users finish. */
+          lock_release (&cache_lock);
+          thread_yield ();
+          continue;
+        }
+
+      /* Write back the old sector before anyone can look for it
+         on disk, which they can do as soon as it is no longer in
+         the cache.  Until then, anyone who wants it finds E and
+         waits for its lock. */
+      if (e->sector != NO_SECTOR && e->dirty)
+        {
+          lock_release (&cache_lock);
+          block_write (fs_device, e->sector, e->data);
+          e->dirty = false;
+          lock_acquire (&cache_lock);
+
+          /* SECTOR may have been cached by someone else while the
+             lock was released.  E stays cached, now clean. */
+          if (lookup (sector) != NULL)
+            {
+              lock_release (&e->lock);
+              lock_release (&cache_lock);
+              continue;
+            }
+        }
+      e->sector = sector;
+      e->dirty = false;
+      e->accessed = true;
+      lock_release (&cache_lock);
+
+      if (fill)
+        block_read (fs_device, sector, e->data);
+      *hit = false;
+      return e;
+    }
+}
+
+/* Reads SIZE bytes starting at byte offset OFS within SECTOR into
+   BUFFER. */
+void
+cache_read (block_sector_t sector, void *buffer, int ofs, int size) 
+{
+  struct cache_entry *e;
+  bool hit;
+
+  ASSERT (ofs >= 0 && size >= 0 && ofs + size <= BLOCK_SECTOR_SIZE);
+
+  e = lock_entry (sector, true, &hit);
+  memcpy (buffer, e->data + ofs, size);
+  lock_release (&e->lock);
+
+  if (hit)
+    hit_cnt++;
+  else
+    miss_cnt++;
+}
+
+/* Writes SIZE bytes from BUFFER into SECTOR starting at byte
+   offset OFS.  The write reaches the disk later. */
+void
+cache_write (block_sector_t sector, const void *buffer, int ofs, int size) 
+{
+  struct cache_entry *e;
+  bool hit;
+
+  ASSERT (ofs >= 0 && size >= 0 && ofs + size <= BLOCK_SECTOR_SIZE);
+
+  e = lock_entry (sector, size < BLOCK_SECTOR_SIZE, &hit);
+  memcpy (e->data + ofs, buffer, size);
+  e->dirty = true;
+  lock_release (&e->lock);
+
+  if (hit)
+    hit_cnt++;
+  else
+    miss_cnt++;
+}
+
+/* Asks for SECTOR to be read into the cache in the background,
+   because it is likely to be read soon.  Does nothing if too
+   many sectors are waiting to be read ahead already. */
+void
+cache_readahead (block_sector_t sector) 
+{
+  lock_acquire (&readahead_lock);
+  if (readahead_cnt < READAHEAD_CNT)
+    {
+      readahead_queue[(readahead_head + readahead_cnt++) % READAHEAD_CNT]
+        = sector;
+      cond_signal (&readahead_cond, &readahead_lock);
+    }
+  lock_release (&readahead_lock);
+}
+
+/* Writes modified sectors back to disk periodically, so that a
+   crash loses at most FLUSH_MS milliseconds of writes. */
+static void
+flush_daemon (void *aux UNUSED) 
+{
+  for (;;)
+    {
+      timer_msleep (FLUSH_MS);
+      cache_flush ();
+    }
+}
+
+/* Reads in the sectors queued by cache_readahead(). */
+static void
+readahead_daemon (void *aux UNUSED) 
+{
+  for (;;)
+    {
+      struct cache_entry *e;
+      block_sector_t sector;
+      bool hit;
+
+      lock_acquire (&readahead_lock);
+      while (readahead_cnt == 0)
+        cond_wait (&readahead_cond, &readahead_lock);
+      sector = readahead_queue[readahead_head];
+      readahead_head = (readahead_head + 1) % READAHEAD_CNT;
+      readahead_cnt--;
+      lock_release (&readahead_lock);
+
+      e = lock_entry (sector, true, &hit);
+      lock_release (&e->lock);
+      if (!hit)
+        readahead_read_cnt++;
+    }
+}
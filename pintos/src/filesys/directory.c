@@ -1,6 +1,7 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
@@ -11,6 +12,7 @@ struct dir
   {
     struct inode *inode;                /* Backing store. */
     off_t pos;                          /* Current position. */
+    struct dir_index *index;            /* Index, or null if none. */
   };
 
 /* A single directory entry. */
@@ -21,24 +23,142 @@ struct dir_entry
     bool in_use;                        /* In use or free? */
   };
 
+/* An in-memory index of a directory's entries, shared by all the
+   `struct dir's open on it.
+
+   A directory is still just an unordered array of `struct
+   dir_entry', but searching that array takes one read per entry,
+   which makes filling a directory with N files take O(N**2)
+   reads.  So the first time a directory is opened, its entries
+   are read once into a hash table keyed by name, and dir_add()
+   and dir_remove() keep that table up to date as they change
+   the entries on disk.  The index also tracks where the unused
+   entries are, so that adding a file need not search for one.
+
+   An index outlives the last `struct dir' open on it, so that a
+   directory that is opened afresh for each operation need not be
+   read again, but at most IDLE_INDEX_MAX such idle indexes are
+   kept.
+
+   A `struct dir' opened while memory was too short to build an
+   index has none, and searches the entries on disk instead.
+   Before it changes them, it picks up any index that has been
+   built since, so that the index never misses a change. */
+struct dir_index
+  {
+    struct list_elem elem;              /* Element in dir_indexes. */
+    block_sector_t sector;              /* Sector of directory's inode. */
+    int open_cnt;                       /* Number of `struct dir's. */
+    struct hash entries;                /* `struct index_entry's. */
+    size_t free_cnt;                    /* Number of unused entries. */
+    off_t free_ofs;                     /* No unused entry before this. */
+  };
+
+/* A directory entry that is in use, in a `struct dir_index'. */
+struct index_entry
+  {
+    struct hash_elem elem;              /* Element in dir_index. */
+    off_t ofs;                          /* Byte offset of entry. */
+    block_sector_t inode_sector;        /* Sector number of header. */
+    char name[NAME_MAX + 1];            /* Null terminated file name. */
+  };
+
+/* The dentry cache remembers the results of recent lookups by
+   dir_lookup_sector(), which resolves paths one component at a
+   time, so that a path whose directories were looked up recently
+   can be resolved without opening any of them.  It is a small
+   direct-mapped table, indexed by a hash of the directory's
+   sector and the name looked up, so a new entry simply replaces
+   whatever was in its slot.  Only successful lookups are cached,
+   so adding a directory entry never makes the cache stale, but
+   dir_remove() must drop the entries it invalidates. */
+struct dentry
+  {
+    block_sector_t dir_sector;          /* Sector of directory's inode. */
+    block_sector_t inode_sector;        /* Sector of entry's inode. */
+    char name[NAME_MAX + 1];            /* Name, or "" if slot unused. */
+  };
+
+/* Number of dentry cache slots. */
+#define DCACHE_CNT 64
+
+/* Dentry cache. */
+static struct dentry dcache[DCACHE_CNT];
+
+static struct dentry *dcache_slot (block_sector_t dir_sector,
+                                   const char *name);
+static void dcache_purge (block_sector_t dir_sector);
+
+/* Maximum number of indexes kept for directories not open. */
+#define IDLE_INDEX_MAX 16
+
+/* Directory indexes, most recently used first. */
+static struct list dir_indexes;
+
+/* Number of indexes in dir_indexes with an open_cnt of 0. */
+static size_t idle_index_cnt;
+
+static struct dir_index *index_find (block_sector_t sector);
+static struct dir_index *index_open (struct inode *);
+static void index_close (struct dir_index *);
+static void index_discard (block_sector_t sector);
+static hash_hash_func index_entry_hash;
+static hash_less_func index_entry_less;
+static hash_action_func index_entry_free;
+
+/* Initializes the directory module. */
+void
+dir_init (void) 
+{
+  list_init (&dir_indexes);
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
-   given SECTOR.  Returns true if successful, false on failure. */
+   given SECTOR, besides its "." and ".." entries, which refer to
+   the directory itself and to the one in PARENT_SECTOR.  Returns
+   true if successful, false on failure. */
 bool
-dir_create (block_sector_t sector, size_t entry_cnt)
+dir_create (block_sector_t sector, block_sector_t parent_sector,
+            size_t entry_cnt)
 {
-  return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+  struct dir_entry e[2];
+  struct inode *inode;
+  bool success;
+
+  /* Forget about any earlier directory in SECTOR. */
+  index_discard (sector);
+  dcache_purge (sector);
+
+  if (!inode_create (sector, (entry_cnt + 2) * sizeof *e, true))
+    return false;
+  inode = inode_open (sector);
+  if (inode == NULL)
+    return false;
+
+  memset (e, 0, sizeof e);
+  e[0].inode_sector = sector;
+  strlcpy (e[0].name, ".", sizeof e[0].name);
+  e[0].in_use = true;
+  e[1].inode_sector = parent_sector;
+  strlcpy (e[1].name, "..", sizeof e[1].name);
+  e[1].in_use = true;
+  success = inode_write_at (inode, e, sizeof e, 0) == sizeof e;
+  inode_close (inode);
+  return success;
 }
 
 /* Opens and returns the directory for the given INODE, of which
-   it takes ownership.  Returns a null pointer on failure. */
+   it takes ownership.  Returns a null pointer on failure,
+   including when INODE is not a directory. */
 struct dir *
 dir_open (struct inode *inode) 
 {
   struct dir *dir = calloc (1, sizeof *dir);
-  if (inode != NULL && dir != NULL)
+  if (inode != NULL && dir != NULL && inode_is_dir (inode))
     {
       dir->inode = inode;
       dir->pos = 0;
+      dir->index = index_open (inode);
       return dir;
     }
   else
@@ -71,6 +191,8 @@ dir_close (struct dir *dir)
 {
   if (dir != NULL)
     {
+      if (dir->index != NULL)
+        index_close (dir->index);
       inode_close (dir->inode);
       free (dir);
     }
@@ -98,6 +220,30 @@ lookup (const struct dir *dir, const char *name,
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  if (dir->index != NULL) 
+    {
+      struct index_entry *ie = NULL;
+      struct index_entry key;
+      struct hash_elem *elem;
+
+      if (strlen (name) > NAME_MAX)
+        return false;
+      strlcpy (key.name, name, sizeof key.name);
+      elem = hash_find (&dir->index->entries, &key.elem);
+      if (elem == NULL)
+        return false;
+      ie = hash_entry (elem, struct index_entry, elem);
+      if (ep != NULL)
+        {
+          ep->inode_sector = ie->inode_sector;
+          strlcpy (ep->name, ie->name, sizeof ep->name);
+          ep->in_use = true;
+        }
+      if (ofsp != NULL)
+        *ofsp = ie->ofs;
+      return true;
+    }
+
   for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
        ofs += sizeof e) 
     if (e.in_use && !strcmp (name, e.name)) 
@@ -132,6 +278,42 @@ dir_lookup (const struct dir *dir, const char *name,
   return *inode != NULL;
 }
 
+/* Looks up NAME in the directory whose inode is in DIR_SECTOR
+   and, if it is found, stores the sector of its inode into
+   *SECTORP and returns true.  Returns false if there is no such
+   entry, or if DIR_SECTOR is not a directory or has been
+   removed.  Consults the dentry cache before the directory
+   itself, so a hit does not open the directory at all. */
+bool
+dir_lookup_sector (block_sector_t dir_sector, const char *name,
+                   block_sector_t *sectorp) 
+{
+  struct dentry *d = dcache_slot (dir_sector, name);
+  struct dir_entry e;
+  struct dir *dir;
+  bool found;
+
+  if (d->dir_sector == dir_sector && !strcmp (d->name, name)
+      && *name != '\0')
+    {
+      *sectorp = d->inode_sector;
+      return true;
+    }
+
+  dir = dir_open (inode_open (dir_sector));
+  found = (dir != NULL && !inode_is_removed (dir->inode)
+           && lookup (dir, name, &e, NULL));
+  dir_close (dir);
+  if (!found)
+    return false;
+
+  d->dir_sector = dir_sector;
+  d->inode_sector = e.inode_sector;
+  strlcpy (d->name, e.name, sizeof d->name);
+  *sectorp = e.inode_sector;
+  return true;
+}
+
 /* Adds a file named NAME to DIR, which must not already contain a
    file by that name.  The file's inode is in sector
    INODE_SECTOR.
@@ -141,8 +323,10 @@ dir_lookup (const struct dir *dir, const char *name,
 bool
 dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
 {
+  struct dir_index *index;
+  struct index_entry *ie = NULL;
   struct dir_entry e;
-  off_t ofs;
+  off_t ofs, length;
   bool success = false;
 
   ASSERT (dir != NULL);
@@ -152,21 +336,43 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   if (*name == '\0' || strlen (name) > NAME_MAX)
     return false;
 
+  /* Keep any index built since DIR was opened up to date. */
+  if (dir->index == NULL)
+    dir->index = index_find (inode_get_inumber (dir->inode));
+  index = dir->index;
+
   /* Check that NAME is not in use. */
   if (lookup (dir, name, NULL, NULL))
     goto done;
 
   /* Set OFS to offset of free slot.
      If there are no free slots, then it will be set to the
-     current end-of-file.
+     current end-of-file.  The index, if any, knows whether
+     there are any free slots and where to start looking.
      
      inode_read_at() will only return a short read at end of file.
      Otherwise, we'd need to verify that we didn't get a short
      read due to something intermittent such as low memory. */
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (!e.in_use)
-      break;
+  length = inode_length (dir->inode);
+  if (index != NULL && index->free_cnt == 0)
+    ofs = length;
+  else
+    for (ofs = index != NULL ? index->free_ofs : 0;
+         inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+         ofs += sizeof e) 
+      if (!e.in_use)
+        break;
+
+  /* Allocate index entry. */
+  if (index != NULL)
+    {
+      ie = malloc (sizeof *ie);
+      if (ie == NULL)
+        goto done;
+      ie->ofs = ofs;
+      ie->inode_sector = inode_sector;
+      strlcpy (ie->name, name, sizeof ie->name);
+    }
 
   /* Write slot. */
   e.in_use = true;
@@ -174,13 +380,28 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   e.inode_sector = inode_sector;
   success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
+  /* Update index. */
+  if (success && index != NULL)
+    {
+      if (ofs < length)
+        {
+          /* Used a free slot rather than extending the file. */
+          index->free_cnt--;
+          index->free_ofs = ofs + sizeof e;
+        }
+      hash_insert (&index->entries, &ie->elem);
+      ie = NULL;
+    }
+
  done:
+  free (ie);
   return success;
 }
 
 /* Removes any entry for NAME in DIR.
-   Returns true if successful, false on failure,
-   which occurs only if there is no file with the given NAME. */
+   Returns true if successful, false on failure, which occurs
+   only if there is no file with the given NAME, if NAME is "."
+   or "..", or if NAME is a directory that is not empty. */
 bool
 dir_remove (struct dir *dir, const char *name) 
 {
@@ -192,8 +413,13 @@ dir_remove (struct dir *dir, const char *name)
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  /* Keep any index built since DIR was opened up to date. */
+  if (dir->index == NULL)
+    dir->index = index_find (inode_get_inumber (dir->inode));
+
   /* Find directory entry. */
-  if (!lookup (dir, name, &e, &ofs))
+  if (!strcmp (name, ".") || !strcmp (name, "..")
+      || !lookup (dir, name, &e, &ofs))
     goto done;
 
   /* Open inode. */
@@ -201,11 +427,42 @@ dir_remove (struct dir *dir, const char *name)
   if (inode == NULL)
     goto done;
 
+  /* Only an empty directory may be removed. */
+  if (inode_is_dir (inode))
+    {
+      struct dir *victim = dir_open (inode_reopen (inode));
+      char victim_name[NAME_MAX + 1];
+      bool empty = victim != NULL && !dir_readdir (victim, victim_name);
+
+      dir_close (victim);
+      if (!empty)
+        goto done;
+    }
+
   /* Erase directory entry. */
   e.in_use = false;
   if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e) 
     goto done;
 
+  /* Drop it from the index. */
+  if (dir->index != NULL)
+    {
+      struct index_entry key;
+      struct hash_elem *elem;
+
+      strlcpy (key.name, name, sizeof key.name);
+      elem = hash_delete (&dir->index->entries, &key.elem);
+      free (hash_entry (elem, struct index_entry, elem));
+      dir->index->free_cnt++;
+      if (ofs < dir->index->free_ofs)
+        dir->index->free_ofs = ofs;
+    }
+
+  /* Drop dentries for it, and for "." and ".." inside it. */
+  dcache_slot (inode_get_inumber (dir->inode), name)->name[0] = '\0';
+  if (inode_is_dir (inode))
+    dcache_purge (e.inode_sector);
+
   /* Remove inode. */
   inode_remove (inode);
   success = true;
@@ -217,7 +474,8 @@ dir_remove (struct dir *dir, const char *name)
 
 /* Reads the next directory entry in DIR and stores the name in
    NAME.  Returns true if successful, false if the directory
-   contains no more entries. */
+   contains no more entries.  The "." and ".." entries are
+   skipped. */
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
@@ -226,7 +484,7 @@ dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
   while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
     {
       dir->pos += sizeof e;
-      if (e.in_use)
+      if (e.in_use && strcmp (e.name, ".") && strcmp (e.name, ".."))
         {
           strlcpy (name, e.name, NAME_MAX + 1);
           return true;
@@ -234,3 +492,204 @@ dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
     }
   return false;
 }
+
+/* Sets DIR's position, from which dir_readdir() reads the next
+   entry, to POS, a value previously returned by dir_tell(). */
+void
+dir_seek (struct dir *dir, off_t pos) 
+{
+  ASSERT (pos >= 0);
+  dir->pos = pos;
+}
+
+/* Returns DIR's position. */
+off_t
+dir_tell (struct dir *dir) 
+{
+  return dir->pos;
+}
+
+/* Returns the dentry cache slot for NAME in the directory whose
+   inode is in DIR_SECTOR. */
+static struct dentry *
+dcache_slot (block_sector_t dir_sector, const char *name) 
+{
+  unsigned h = hash_int (dir_sector) ^ hash_string (name);
+  return &dcache[h % DCACHE_CNT];
+}
+
+/* Drops every dentry for an entry in the directory whose inode
+   is in DIR_SECTOR. */
+static void
+dcache_purge (block_sector_t dir_sector) 
+{
+  struct dentry *d;
+
+  for (d = dcache; d < dcache + DCACHE_CNT; d++)
+    if (d->dir_sector == dir_sector)
+      d->name[0] = '\0';
+}
+
+/* Returns the existing index for the directory whose inode is
+   in SECTOR, with a reference taken for the caller, or a null
+   pointer if there is none. */
+static struct dir_index *
+index_find (block_sector_t sector) 
+{
+  struct list_elem *le;
+
+  for (le = list_begin (&dir_indexes); le != list_end (&dir_indexes);
+       le = list_next (le))
+    {
+      struct dir_index *index = list_entry (le, struct dir_index, elem);
+      if (index->sector == sector)
+        {
+          if (index->open_cnt++ == 0)
+            idle_index_cnt--;
+          list_remove (&index->elem);
+          list_push_front (&dir_indexes, &index->elem);
+          return index;
+        }
+    }
+  return NULL;
+}
+
+/* Returns the index for directory INODE, reading the
+   directory's entries into a new index if there is none yet.
+   Returns a null pointer if memory is short, in which case the
+   directory is searched entry by entry instead. */
+static struct dir_index *
+index_open (struct inode *inode) 
+{
+  block_sector_t sector = inode_get_inumber (inode);
+  struct dir_index *index;
+  struct dir_entry e;
+  off_t ofs;
+
+  index = index_find (sector);
+  if (index != NULL)
+    return index;
+
+  index = malloc (sizeof *index);
+  if (index == NULL)
+    return NULL;
+  if (!hash_init (&index->entries, index_entry_hash, index_entry_less,
+                  NULL))
+    {
+      free (index);
+      return NULL;
+    }
+  index->sector = sector;
+  index->open_cnt = 1;
+  index->free_cnt = 0;
+  index->free_ofs = -1;
+
+  for (ofs = 0; inode_read_at (inode, &e, sizeof e, ofs) == sizeof e;
+       ofs += sizeof e)
+    if (e.in_use)
+      {
+        struct index_entry *ie = malloc (sizeof *ie);
+        if (ie == NULL)
+          {
+            hash_destroy (&index->entries, index_entry_free);
+            free (index);
+            return NULL;
+          }
+        ie->ofs = ofs;
+        ie->inode_sector = e.inode_sector;
+        strlcpy (ie->name, e.name, sizeof ie->name);
+        hash_insert (&index->entries, &ie->elem);
+      }
+    else
+      {
+        index->free_cnt++;
+        if (index->free_ofs == -1)
+          index->free_ofs = ofs;
+      }
+  if (index->free_ofs == -1)
+    index->free_ofs = ofs;
+
+  list_push_front (&dir_indexes, &index->elem);
+  return index;
+}
+
+/* Frees INDEX. */
+static void
+index_free (struct dir_index *index) 
+{
+  list_remove (&index->elem);
+  hash_destroy (&index->entries, index_entry_free);
+  free (index);
+}
+
+/* Releases a reference to INDEX.  If that leaves too many idle
+   indexes, frees the least recently used one. */
+static void
+index_close (struct dir_index *index) 
+{
+  ASSERT (index->open_cnt > 0);
+  if (--index->open_cnt > 0)
+    return;
+
+  if (++idle_index_cnt > IDLE_INDEX_MAX)
+    {
+      struct list_elem *e;
+
+      for (e = list_rbegin (&dir_indexes); e != list_rend (&dir_indexes);
+           e = list_prev (e))
+        {
+          struct dir_index *victim = list_entry (e, struct dir_index, elem);
+          if (victim->open_cnt == 0)
+            {
+              index_free (victim);
+              idle_index_cnt--;
+              break;
+            }
+        }
+    }
+}
+
+/* Frees any index for a directory in SECTOR, which is about to be
+   reused.  Such an index must be idle, because the directory's
+   inode is not freed until its last opener closes it. */
+static void
+index_discard (block_sector_t sector) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&dir_indexes); e != list_end (&dir_indexes);
+       e = list_next (e))
+    {
+      struct dir_index *index = list_entry (e, struct dir_index, elem);
+      if (index->sector == sector)
+        {
+          ASSERT (index->open_cnt == 0);
+          index_free (index);
+          idle_index_cnt--;
+          return;
+        }
+    }
+}
+
+/* Returns a hash value for the index entry E. */
+static unsigned
+index_entry_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  return hash_string (hash_entry (e, struct index_entry, elem)->name);
+}
+
+/* Returns true if index entry A's name precedes B's. */
+static bool
+index_entry_less (const struct hash_elem *a, const struct hash_elem *b,
+                  void *aux UNUSED) 
+{
+  return strcmp (hash_entry (a, struct index_entry, elem)->name,
+                 hash_entry (b, struct index_entry, elem)->name) < 0;
+}
+
+/* Frees index entry E. */
+static void
+index_entry_free (struct hash_elem *e, void *aux UNUSED) 
+{
+  free (hash_entry (e, struct index_entry, elem));
+}
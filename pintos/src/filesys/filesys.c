@@ -2,14 +2,19 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "threads/thread.h"
 
 /* Partition that contains the file system. */
 struct block *fs_device;
 
+static struct dir *open_parent (const char *path, char name[NAME_MAX + 1]);
+static struct inode *open_path (const char *path);
+static bool create_entry (const char *path, off_t initial_size, bool is_dir);
 static void do_format (void);
 
 /* Initializes the file system module.
@@ -21,7 +26,9 @@ filesys_init (bool format)
   if (fs_device == NULL)
     PANIC ("No file system device found, can't initialize file system.");
 
+  cache_init ();
   inode_init ();
+  dir_init ();
   free_map_init ();
 
   if (format) 
@@ -36,6 +43,7 @@ void
 filesys_done (void) 
 {
   free_map_close ();
+  cache_flush ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -45,20 +53,20 @@ filesys_done (void)
 bool
 filesys_create (const char *name, off_t initial_size) 
 {
-  block_sector_t inode_sector = 0;
-  struct dir *dir = dir_open_root ();
-  bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size)
-                  && dir_add (dir, name, inode_sector));
-  if (!success && inode_sector != 0) 
-    free_map_release (inode_sector, 1);
-  dir_close (dir);
+  return create_entry (name, initial_size, false);
+}
 
-  return success;
+/* Creates a directory named NAME.
+   Returns true if successful, false otherwise.
+   Fails if a file or directory named NAME already exists,
+   or if internal memory allocation fails. */
+bool
+filesys_mkdir (const char *name) 
+{
+  return create_entry (name, 0, true);
 }
 
-/* Opens the file with the given NAME.
+/* Opens the file or directory with the given NAME.
    Returns the new file if successful or a null pointer
    otherwise.
    Fails if no file named NAME exists,
@@ -66,29 +74,160 @@ filesys_create (const char *name, off_t initial_size)
 struct file *
 filesys_open (const char *name)
 {
-  struct dir *dir = dir_open_root ();
-  struct inode *inode = NULL;
-
-  if (dir != NULL)
-    dir_lookup (dir, name, &inode);
-  dir_close (dir);
-
-  return file_open (inode);
+  return file_open (open_path (name));
 }
 
-/* Deletes the file named NAME.
+/* Deletes the file or empty directory named NAME.
    Returns true if successful, false on failure.
    Fails if no file named NAME exists,
    or if an internal memory allocation fails. */
 bool
 filesys_remove (const char *name) 
 {
-  struct dir *dir = dir_open_root ();
-  bool success = dir != NULL && dir_remove (dir, name);
+  char base[NAME_MAX + 1];
+  struct dir *dir = open_parent (name, base);
+  bool success = dir != NULL && dir_remove (dir, base);
   dir_close (dir); 
 
   return success;
 }
+
+/* Changes the current thread's current directory to the
+   directory named NAME.
+   Returns true if successful, false on failure. */
+bool
+filesys_chdir (const char *name) 
+{
+  struct thread *t = thread_current ();
+  struct dir *dir = dir_open (open_path (name));
+
+  if (dir == NULL)
+    return false;
+  dir_close (t->cwd);
+  t->cwd = dir;
+  return true;
+}
+
+/* Extracts a file name part from *SRCP into PART, and updates
+   *SRCP so that the next call will return the next file name
+   part.  Returns 1 if successful, 0 at end of string, -1 for a
+   too-long file name part. */
+static int
+get_next_part (char part[NAME_MAX + 1], const char **srcp)
+{
+  const char *src = *srcp;
+  char *dst = part;
+
+  /* Skip leading slashes.  If it's all slashes, we're done. */
+  while (*src == '/')
+    src++;
+  if (*src == '\0')
+    return 0;
+
+  /* Copy up to NAME_MAX character from SRC to DST.  Add null
+     terminator. */
+  while (*src != '/' && *src != '\0') 
+    {
+      if (dst < part + NAME_MAX)
+        *dst++ = *src;
+      else
+        return -1;
+      src++; 
+    }
+  *dst = '\0';
+
+  /* Advance source pointer. */
+  *srcp = src;
+  return 1;
+}
+
+/* Opens the directory that holds the last component of PATH,
+   and copies that component into NAME.  PATH is relative to the
+   current directory unless it starts with '/'.  A PATH made up
+   only of slashes names the root directory, as if it were "/.".
+
+   The directories along the way are found with
+   dir_lookup_sector(), which uses the dentry cache, so only the
+   last of them is actually opened.
+
+   Returns a null pointer if PATH is empty, if a component is
+   longer than NAME_MAX, or if a directory along the way does
+   not exist or has been removed. */
+static struct dir *
+open_parent (const char *path, char name[NAME_MAX + 1]) 
+{
+  struct dir *cwd = thread_current ()->cwd;
+  block_sector_t sector;
+  char next[NAME_MAX + 1];
+  struct dir *dir;
+  int result;
+
+  if (*path == '\0')
+    return NULL;
+  if (*path == '/' || cwd == NULL)
+    sector = ROOT_DIR_SECTOR;
+  else
+    sector = inode_get_inumber (dir_get_inode (cwd));
+
+  strlcpy (name, ".", NAME_MAX + 1);
+  result = get_next_part (name, &path);
+  if (result > 0)
+    while ((result = get_next_part (next, &path)) > 0)
+      {
+        if (!dir_lookup_sector (sector, name, &sector))
+          return NULL;
+        strlcpy (name, next, NAME_MAX + 1);
+      }
+  if (result < 0)
+    return NULL;
+
+  dir = dir_open (inode_open (sector));
+  if (dir != NULL && inode_is_removed (dir_get_inode (dir)))
+    {
+      dir_close (dir);
+      return NULL;
+    }
+  return dir;
+}
+
+/* Opens and returns the inode for the file or directory named
+   PATH, or a null pointer if there is none. */
+static struct inode *
+open_path (const char *path) 
+{
+  char name[NAME_MAX + 1];
+  struct dir *dir = open_parent (path, name);
+  struct inode *inode = NULL;
+
+  if (dir != NULL)
+    dir_lookup (dir, name, &inode);
+  dir_close (dir);
+  return inode;
+}
+
+/* Creates a file, with INITIAL_SIZE bytes, or a directory,
+   according to IS_DIR, named PATH.
+   Returns true if successful, false otherwise. */
+static bool
+create_entry (const char *path, off_t initial_size, bool is_dir) 
+{
+  char name[NAME_MAX + 1];
+  block_sector_t inode_sector = 0;
+  struct dir *dir = open_parent (path, name);
+  bool success = (dir != NULL
+                  && free_map_allocate (1, &inode_sector)
+                  && (is_dir
+                      ? dir_create (inode_sector,
+                                    inode_get_inumber (dir_get_inode (dir)),
+                                    0)
+                      : inode_create (inode_sector, initial_size, false))
+                  && dir_add (dir, name, inode_sector));
+  if (!success && inode_sector != 0) 
+    free_map_release (inode_sector, 1);
+  dir_close (dir);
+
+  return success;
+}
 
 /* Formats the file system. */
 static void
@@ -96,7 +235,7 @@ do_format (void)
 {
   printf ("Formatting file system...");
   free_map_create ();
-  if (!dir_create (ROOT_DIR_SECTOR, 16))
+  if (!dir_create (ROOT_DIR_SECTOR, ROOT_DIR_SECTOR, 16))
     PANIC ("root directory creation failed");
   free_map_close ();
   printf ("done.\n");
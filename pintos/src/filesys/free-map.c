@@ -40,6 +40,52 @@ free_map_allocate (size_t cnt, block_sector_t *sectorp)
   return sector != BITMAP_ERROR;
 }
 
+/* Allocates a run of up to CNT consecutive sectors, preferably
+   starting at or after sector HINT, and stores the first into
+   *SECTORP.  A whole run of CNT sectors is preferred to a
+   shorter one, but if the disk is too fragmented for that, the
+   first free sector at or after HINT (or, failing that, anywhere
+   on the disk) is taken along with whatever free sectors
+   directly follow it.
+   Returns the number of sectors allocated, which is 0 only if
+   the disk is full or if the free_map file could not be
+   written. */
+size_t
+free_map_allocate_run (block_sector_t hint, size_t cnt,
+                       block_sector_t *sectorp)
+{
+  size_t size = bitmap_size (free_map);
+  size_t sector;
+  size_t run;
+
+  ASSERT (cnt > 0);
+
+  if (hint >= size)
+    hint = 0;
+  sector = bitmap_scan (free_map, hint, cnt, false);
+  if (sector == BITMAP_ERROR)
+    sector = bitmap_scan (free_map, 0, cnt, false);
+  if (sector == BITMAP_ERROR)
+    sector = bitmap_scan (free_map, hint, 1, false);
+  if (sector == BITMAP_ERROR)
+    sector = bitmap_scan (free_map, 0, 1, false);
+  if (sector == BITMAP_ERROR)
+    return 0;
+
+  for (run = 1; run < cnt && sector + run < size; run++)
+    if (bitmap_test (free_map, sector + run))
+      break;
+
+  bitmap_set_multiple (free_map, sector, run, true);
+  if (free_map_file != NULL && !bitmap_write (free_map, free_map_file))
+    {
+      bitmap_set_multiple (free_map, sector, run, false);
+      return 0;
+    }
+  *sectorp = sector;
+  return run;
+}
+
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
@@ -73,7 +119,7 @@ void
 free_map_create (void) 
 {
   /* Create inode. */
-  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map)))
+  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map), false))
     PANIC ("free map creation failed");
 
   /* Write bitmap to file. */
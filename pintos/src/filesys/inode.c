@@ -2,7 +2,9 @@
 #include <list.h>
 #include <debug.h>
 #include <round.h>
+#include <stddef.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
@@ -10,23 +12,53 @@
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* A file's data sectors are found through a multilevel index.
+   The inode holds the numbers of the first DIRECT_CNT data
+   sectors, followed by the number of one indirect sector, which
+   holds the numbers of the next PTRS_PER_SECTOR data sectors,
+   and of one doubly indirect sector, which holds the numbers of
+   PTRS_PER_SECTOR more indirect sectors.  That is enough for a
+   file of a little over 8 MB.
+
+   A sector number of 0 means that no sector has been allocated.
+   (Sector 0 holds the free map's inode, so it is never part of a
+   file.)  A file may have such holes where it was extended by a
+   write past its end, and they read as zeros. */
+#define DIRECT_CNT 123
+#define INDIRECT_SLOT DIRECT_CNT
+#define DBL_INDIRECT_SLOT (DIRECT_CNT + 1)
+#define PTRS_PER_SECTOR ((off_t) (BLOCK_SECTOR_SIZE / sizeof (block_sector_t)))
+
+/* Maximum length of a file, in sectors. */
+#define MAX_SECTORS (DIRECT_CNT + PTRS_PER_SECTOR \
+                     + PTRS_PER_SECTOR * PTRS_PER_SECTOR)
+
+/* Number of sectors reserved at a time for a write that extends
+   a file. */
+#define PREALLOC_CNT 32
+
 /* On-disk inode.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
 struct inode_disk
   {
-    block_sector_t start;               /* First data sector. */
+    block_sector_t sectors[DIRECT_CNT + 2]; /* Index, must be first. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
-    uint32_t unused[125];               /* Not used. */
+    uint32_t is_dir;                    /* Nonzero for a directory. */
   };
 
-/* Returns the number of sectors to allocate for an inode SIZE
-   bytes long. */
-static inline size_t
-bytes_to_sectors (off_t size)
-{
-  return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
-}
+/* Data sectors reserved for a file ahead of need, so that a file
+   that grows a little at a time is still laid out in long runs
+   of consecutive sectors.  New data sectors are taken in order
+   from START, and once they are used up, the next run is
+   allocated as near HINT, normally just past the file's last
+   data sector, as the free map allows. */
+struct prealloc
+  {
+    block_sector_t start;               /* First reserved sector. */
+    size_t cnt;                         /* Number of reserved sectors. */
+    block_sector_t hint;                /* Where to start the next run. */
+  };
 
 /* In-memory inode. */
 struct inode 
@@ -36,21 +68,178 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
-    struct inode_disk data;             /* Inode content. */
+    off_t length;                       /* Copy of inode_disk's length. */
+    bool is_dir;                        /* Copy of inode_disk's is_dir. */
+    struct prealloc prealloc;           /* Reserved data sectors. */
   };
 
-/* Returns the block device sector that contains byte offset POS
-   within INODE.
-   Returns -1 if INODE does not contain data for a byte at offset
-   POS. */
+/* A sector's worth of zeros. */
+static char zeros[BLOCK_SECTOR_SIZE];
+
+static block_sector_t get_slot (block_sector_t, off_t slot, bool create);
+static block_sector_t get_data_slot (block_sector_t, off_t slot,
+                                     struct prealloc *, size_t run_cnt);
+static void release_tree (block_sector_t, int depth);
+
+/* Returns the sector that holds byte offset POS within the file
+   whose inode is in INODE_SECTOR, or 0 if it has none.  If PA is
+   nonnull, a missing data sector and any missing index sectors
+   on the way to it are allocated, zeroed, and linked in, and 0
+   is returned only if the disk is full.  The data sector comes
+   from PA's reserved sectors, reserving up to RUN_CNT more
+   first if there are none left.  Also returns 0 if POS is past
+   the largest possible file.
+
+   The inode and index sectors are read through the buffer cache
+   one sector number at a time, so that this takes one cache
+   access for offsets in the first DIRECT_CNT sectors, and one
+   more for each level of indirection beyond that. */
 static block_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) 
+byte_to_sector (block_sector_t inode_sector, off_t pos,
+                struct prealloc *pa, size_t run_cnt) 
 {
-  ASSERT (inode != NULL);
-  if (pos < inode->data.length)
-    return inode->data.start + pos / BLOCK_SECTOR_SIZE;
-  else
-    return -1;
+  off_t idx = pos / BLOCK_SECTOR_SIZE;
+  bool create = pa != NULL;
+  block_sector_t sector;
+
+  if (idx < DIRECT_CNT)
+    return get_data_slot (inode_sector, idx, pa, run_cnt);
+  idx -= DIRECT_CNT;
+
+  if (idx < PTRS_PER_SECTOR)
+    {
+      sector = get_slot (inode_sector, INDIRECT_SLOT, create);
+      return (sector != 0
+              ? get_data_slot (sector, idx, pa, run_cnt) : 0);
+    }
+  idx -= PTRS_PER_SECTOR;
+
+  if (idx < PTRS_PER_SECTOR * PTRS_PER_SECTOR)
+    {
+      sector = get_slot (inode_sector, DBL_INDIRECT_SLOT, create);
+      if (sector != 0)
+        sector = get_slot (sector, idx / PTRS_PER_SECTOR, create);
+      if (sector != 0)
+        sector = get_data_slot (sector, idx % PTRS_PER_SECTOR,
+                                pa, run_cnt);
+      return sector;
+    }
+
+  return 0;
+}
+
+/* Returns the sector number in slot SLOT of SECTOR, which is an
+   inode or an index sector, either of which starts with an array
+   of sector numbers.  If the slot is empty and CREATE is true,
+   allocates a zeroed sector and puts its number in the slot,
+   returning 0 only if the disk is full.
+
+   Index sectors are allocated wherever the free map has room,
+   not from a file's reserved data sectors, so that they do not
+   break up its runs of data. */
+static block_sector_t
+get_slot (block_sector_t sector, off_t slot, bool create) 
+{
+  block_sector_t ptr;
+  int ofs = slot * sizeof ptr;
+
+  cache_read (sector, &ptr, ofs, sizeof ptr);
+  if (ptr == 0 && create && free_map_allocate (1, &ptr))
+    {
+      cache_write (ptr, zeros, 0, BLOCK_SECTOR_SIZE);
+      cache_write (sector, &ptr, ofs, sizeof ptr);
+    }
+  return ptr;
+}
+
+/* Takes the next of PA's reserved sectors, first reserving a new
+   run of up to RUN_CNT sectors if none are left.  Returns the
+   sector, or 0 if the disk is full. */
+static block_sector_t
+take_sector (struct prealloc *pa, size_t run_cnt) 
+{
+  if (pa->cnt == 0)
+    {
+      pa->cnt = free_map_allocate_run (pa->hint, run_cnt, &pa->start);
+      if (pa->cnt == 0)
+        return 0;
+    }
+  pa->cnt--;
+  pa->hint = pa->start + 1;
+  return pa->start++;
+}
+
+/* Returns PA's unused reserved sectors to the free map. */
+static void
+release_prealloc (struct prealloc *pa) 
+{
+  if (pa->cnt > 0)
+    free_map_release (pa->start, pa->cnt);
+  pa->cnt = 0;
+}
+
+/* Like get_slot(), but for a slot that holds the number of a
+   data sector.  If the slot is empty and PA is nonnull, the
+   sector is taken from PA with take_sector(). */
+static block_sector_t
+get_data_slot (block_sector_t sector, off_t slot, struct prealloc *pa,
+               size_t run_cnt) 
+{
+  block_sector_t ptr;
+  int ofs = slot * sizeof ptr;
+
+  cache_read (sector, &ptr, ofs, sizeof ptr);
+  if (ptr == 0 && pa != NULL && (ptr = take_sector (pa, run_cnt)) != 0)
+    {
+      cache_write (ptr, zeros, 0, BLOCK_SECTOR_SIZE);
+      cache_write (sector, &ptr, ofs, sizeof ptr);
+    }
+  return ptr;
+}
+
+/* Frees SECTOR, and if DEPTH is greater than 0, the sectors it
+   indexes, each of which indexes DEPTH - 1 levels of sectors
+   itself. */
+static void
+release_tree (block_sector_t sector, int depth) 
+{
+  if (depth > 0)
+    {
+      off_t slot;
+
+      for (slot = 0; slot < PTRS_PER_SECTOR; slot++)
+        {
+          block_sector_t ptr = get_slot (sector, slot, false);
+          if (ptr != 0)
+            release_tree (ptr, depth - 1);
+        }
+    }
+  free_map_release (sector, 1);
+}
+
+/* Frees all the data and index sectors of the file whose inode is
+   in INODE_SECTOR, but not the inode itself. */
+static void
+release_data (block_sector_t inode_sector) 
+{
+  off_t slot;
+
+  for (slot = 0; slot < DIRECT_CNT + 2; slot++)
+    {
+      block_sector_t ptr = get_slot (inode_sector, slot, false);
+      if (ptr != 0)
+        release_tree (ptr, (slot < DIRECT_CNT ? 0
+                            : slot == INDIRECT_SLOT ? 1 : 2));
+    }
+}
+
+/* Writes LENGTH into INODE's on-disk inode. */
+static void
+set_length (struct inode *inode, off_t length) 
+{
+  inode->length = length;
+  cache_write (inode->sector, &length, offsetof (struct inode_disk, length),
+               sizeof length);
 }
 
 /* List of open inodes, so that opening a single inode twice
@@ -64,16 +253,21 @@ inode_init (void)
   list_init (&open_inodes);
 }
 
-/* Initializes an inode with LENGTH bytes of data and
+/* Initializes an inode with LENGTH bytes of data, for a
+   directory if IS_DIR is true or an ordinary file otherwise, and
    writes the new inode to sector SECTOR on the file system
-   device.
+   device.  The data sectors are allocated, zeroed, right away,
+   so that creating a file fails if there is no room for it, and
+   in as few runs of consecutive sectors as possible, starting
+   right after the inode.
    Returns true if successful.
    Returns false if memory or disk allocation fails. */
 bool
-inode_create (block_sector_t sector, off_t length)
+inode_create (block_sector_t sector, off_t length, bool is_dir)
 {
   struct inode_disk *disk_inode = NULL;
-  bool success = false;
+  struct prealloc pa;
+  off_t ofs;
 
   ASSERT (length >= 0);
 
@@ -81,28 +275,30 @@ inode_create (block_sector_t sector, off_t length)
      one sector in size, and you should fix that. */
   ASSERT (sizeof *disk_inode == BLOCK_SECTOR_SIZE);
 
+  if (DIV_ROUND_UP (length, BLOCK_SECTOR_SIZE) > MAX_SECTORS)
+    return false;
+
   disk_inode = calloc (1, sizeof *disk_inode);
-  if (disk_inode != NULL)
-    {
-      size_t sectors = bytes_to_sectors (length);
-      disk_inode->length = length;
-      disk_inode->magic = INODE_MAGIC;
-      if (free_map_allocate (sectors, &disk_inode->start)) 
-        {
-          block_write (fs_device, sector, disk_inode);
-          if (sectors > 0) 
-            {
-              static char zeros[BLOCK_SECTOR_SIZE];
-              size_t i;
-              
-              for (i = 0; i < sectors; i++) 
-                block_write (fs_device, disk_inode->start + i, zeros);
-            }
-          success = true; 
-        } 
-      free (disk_inode);
-    }
-  return success;
+  if (disk_inode == NULL)
+    return false;
+  disk_inode->length = length;
+  disk_inode->magic = INODE_MAGIC;
+  disk_inode->is_dir = is_dir;
+  cache_write (sector, disk_inode, 0, BLOCK_SECTOR_SIZE);
+  free (disk_inode);
+
+  pa.cnt = 0;
+  pa.hint = sector + 1;
+  for (ofs = 0; ofs < length; ofs += BLOCK_SECTOR_SIZE)
+    if (byte_to_sector (sector, ofs, &pa,
+                        DIV_ROUND_UP (length - ofs, BLOCK_SECTOR_SIZE)) == 0)
+      {
+        release_prealloc (&pa);
+        release_data (sector);
+        return false;
+      }
+  release_prealloc (&pa);
+  return true;
 }
 
 /* Reads an inode from SECTOR
@@ -113,6 +309,7 @@ inode_open (block_sector_t sector)
 {
   struct list_elem *e;
   struct inode *inode;
+  uint32_t is_dir;
 
   /* Check whether this inode is already open. */
   for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
@@ -137,7 +334,22 @@ inode_open (block_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  block_read (fs_device, inode->sector, &inode->data);
+  cache_read (inode->sector, &inode->length,
+              offsetof (struct inode_disk, length), sizeof inode->length);
+  cache_read (inode->sector, &is_dir, offsetof (struct inode_disk, is_dir),
+              sizeof is_dir);
+  inode->is_dir = is_dir != 0;
+
+  /* Extend the file from where its data ends. */
+  inode->prealloc.cnt = 0;
+  inode->prealloc.hint = inode->sector + 1;
+  if (inode->length > 0)
+    {
+      block_sector_t last = byte_to_sector (sector, inode->length - 1,
+                                            NULL, 0);
+      if (last != 0)
+        inode->prealloc.hint = last + 1;
+    }
   return inode;
 }
 
@@ -150,6 +362,22 @@ inode_reopen (struct inode *inode)
   return inode;
 }
 
+/* Returns true if INODE is a directory, false if it is an
+   ordinary file. */
+bool
+inode_is_dir (const struct inode *inode)
+{
+  return inode->is_dir;
+}
+
+/* Returns true if INODE has been removed, so that it will be
+   deleted when its last opener closes it. */
+bool
+inode_is_removed (const struct inode *inode)
+{
+  return inode->removed;
+}
+
 /* Returns INODE's inode number. */
 block_sector_t
 inode_get_inumber (const struct inode *inode)
@@ -172,13 +400,13 @@ inode_close (struct inode *inode)
     {
       /* Remove from inode list and release lock. */
       list_remove (&inode->elem);
+      release_prealloc (&inode->prealloc);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
+          release_data (inode->sector);
           free_map_release (inode->sector, 1);
-          free_map_release (inode->data.start,
-                            bytes_to_sectors (inode->data.length)); 
         }
 
       free (inode); 
@@ -196,18 +424,19 @@ inode_remove (struct inode *inode)
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
-   than SIZE if an error occurs or end of file is reached. */
+   than SIZE if an error occurs or end of file is reached.
+   Reading a sector starts reading the next one ahead. */
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) 
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
 
   while (size > 0) 
     {
       /* Disk sector to read, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      block_sector_t sector_idx = byte_to_sector (inode->sector, offset,
+                                                  NULL, 0);
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -220,47 +449,49 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
-        }
-      else 
-        {
-          /* Read sector into bounce buffer, then partially copy
-             into caller's buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-          block_read (fs_device, sector_idx, bounce);
-          memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-        }
+      if (sector_idx != 0)
+        cache_read (sector_idx, buffer + bytes_read, sector_ofs, chunk_size);
+      else
+        memset (buffer + bytes_read, 0, chunk_size);
       
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
+
+  if (bytes_read > 0)
+    {
+      /* The next sector is next to be read, if reads are
+         sequential. */
+      off_t next = ROUND_UP (offset, BLOCK_SECTOR_SIZE);
+      if (next < inode_length (inode))
+        {
+          block_sector_t sector = byte_to_sector (inode->sector, next,
+                                                  NULL, 0);
+          if (sector != 0)
+            cache_readahead (sector);
+        }
+    }
 
   return bytes_read;
 }
 
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if the disk fills up or the file reaches its
+   maximum size.  A write past end of file extends the file,
+   leaving a hole that reads as zeros between the old end and
+   OFFSET.  Such a write reserves PREALLOC_CNT sectors at a time
+   for the data it appends, which are given back when the inode
+   is closed if the file never grows into them. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
                 off_t offset) 
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
+  size_t run_cnt = offset + size > inode->length ? PREALLOC_CNT : 1;
 
   if (inode->deny_write_cnt)
     return 0;
@@ -268,51 +499,29 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   while (size > 0) 
     {
       /* Sector to write, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      block_sector_t sector_idx = byte_to_sector (inode->sector, offset,
+                                                  &inode->prealloc, run_cnt);
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = inode_length (inode) - offset;
+      /* Bytes left in sector. */
       int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
 
       /* Number of bytes to actually write into this sector. */
-      int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0)
+      int chunk_size = size < sector_left ? size : sector_left;
+      if (sector_idx == 0)
         break;
 
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
-        {
-          /* Write full sector directly to disk. */
-          block_write (fs_device, sector_idx, buffer + bytes_written);
-        }
-      else 
-        {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) 
-            block_read (fs_device, sector_idx, bounce);
-          else
-            memset (bounce, 0, BLOCK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          block_write (fs_device, sector_idx, bounce);
-        }
+      cache_write (sector_idx, buffer + bytes_written, sector_ofs,
+                   chunk_size);
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
+
+  if (bytes_written > 0 && offset > inode->length)
+    set_length (inode, offset);
 
   return bytes_written;
 }
@@ -341,5 +550,5 @@ inode_allow_write (struct inode *inode)
 off_t
 inode_length (const struct inode *inode)
 {
-  return inode->data.length;
+  return inode->length;
 }
@@ -289,6 +289,30 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 
 /* Finding set or unset bits. */
 
+/* Returns the index of the first bit at or after START in B
+   that is set to VALUE, or BITMAP_ERROR if there is none.
+   Elements with no such bit are skipped whole, and the bit
+   within an element is found with a single bit scan. */
+static size_t
+scan_one (const struct bitmap *b, size_t start, bool value) 
+{
+  size_t i;
+
+  for (i = elem_idx (start); i < elem_cnt (b->bit_cnt); i++)
+    {
+      elem_type bits = value ? b->bits[i] : ~b->bits[i];
+
+      if (i == elem_idx (start))
+        bits &= ~(bit_mask (start) - 1);
+      if (bits != 0)
+        {
+          size_t idx = i * ELEM_BITS + __builtin_ctzl (bits);
+          return idx < b->bit_cnt ? idx : BITMAP_ERROR;
+        }
+    }
+  return BITMAP_ERROR;
+}
+
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
@@ -299,6 +323,8 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
+  if (cnt == 1)
+    return scan_one (b, start, value);
   if (cnt <= b->bit_cnt) 
     {
       size_t last = b->bit_cnt - cnt;
@@ -0,0 +1,94 @@
+/* Measures how fast a 4 MB file can be written, copied, and read
+   back, and reports the cycles taken per kB for each.  The file
+   is first grown by appending to it in 4 kB writes, then copied
+   1 kB at a time into a file created at its full size, the way
+   examples/cp does it, and then the copy is read sequentially.
+
+   The copy's data sectors are allocated all at once when it is
+   created and the original's a run at a time as it grows, so
+   both should be laid out in long runs of consecutive sectors,
+   which the shutdown statistics' read-ahead count reflects.
+
+   The original is written as a repeated block of random data, and
+   afterward the copy is checked to hold the same data. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (4 * 1024 * 1024)
+
+static char pattern[4096];
+static char buf[4096];
+
+static void report (const char *name, uint64_t cycles);
+static void check_copy (void);
+
+void
+test_main (void) 
+{
+  uint64_t start;
+  int in_fd, out_fd;
+  size_t ofs;
+
+  random_bytes (pattern, sizeof pattern);
+  CHECK (create ("original", 0), "create \"original\"");
+  CHECK ((out_fd = open ("original")) > 1, "open \"original\"");
+  start = rdtsc ();
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof pattern)
+    if (write (out_fd, pattern, sizeof pattern) != sizeof pattern)
+      fail ("write at offset %zu failed", ofs);
+  report ("append", rdtsc () - start);
+  close (out_fd);
+
+  CHECK ((in_fd = open ("original")) > 1, "open \"original\"");
+  start = rdtsc ();
+  CHECK (create ("copy", filesize (in_fd)), "create \"copy\"");
+  CHECK ((out_fd = open ("copy")) > 1, "open \"copy\"");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += 1024)
+    if (read (in_fd, buf, 1024) != 1024 || write (out_fd, buf, 1024) != 1024)
+      fail ("copy at offset %zu failed", ofs);
+  report ("copy", rdtsc () - start);
+  close (in_fd);
+  close (out_fd);
+
+  CHECK ((in_fd = open ("copy")) > 1, "open \"copy\"");
+  start = rdtsc ();
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof buf)
+    if (read (in_fd, buf, sizeof buf) != sizeof buf)
+      fail ("read at offset %zu failed", ofs);
+  report ("read", rdtsc () - start);
+  close (in_fd);
+
+  check_copy ();
+}
+
+/* Reports taking CYCLES cycles for the test phase NAME. */
+static void
+report (const char *name, uint64_t cycles) 
+{
+  msg ("%s: %llu cycles per kB", name,
+       (unsigned long long) (cycles / (FILE_SIZE / 1024)));
+}
+
+/* Checks that every block of "copy" holds the data written to
+   the original. */
+static void
+check_copy (void) 
+{
+  int fd;
+  size_t ofs;
+
+  CHECK ((fd = open ("copy")) > 1, "open \"copy\" for verification");
+  if (filesize (fd) != FILE_SIZE)
+    fail ("size of \"copy\" is %d, not %d", filesize (fd), FILE_SIZE);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof buf)
+    {
+      if (read (fd, buf, sizeof buf) != sizeof buf)
+        fail ("read of \"copy\" at offset %zu failed", ofs);
+      compare_bytes (buf, pattern, sizeof buf, ofs, "copy");
+    }
+  msg ("verified contents of \"copy\"");
+  close (fd);
+}
@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The cost per kB varies from run to run.
+s/: \d+ cycles per kB/: N cycles per kB/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(lg-copy-rate) begin
+(lg-copy-rate) create "original"
+(lg-copy-rate) open "original"
+(lg-copy-rate) append: N cycles per kB
+(lg-copy-rate) open "original"
+(lg-copy-rate) create "copy"
+(lg-copy-rate) open "copy"
+(lg-copy-rate) copy: N cycles per kB
+(lg-copy-rate) open "copy"
+(lg-copy-rate) read: N cycles per kB
+(lg-copy-rate) open "copy" for verification
+(lg-copy-rate) verified contents of "copy"
+(lg-copy-rate) end
+lg-copy-rate: exit(0)
+EOF
+pass;
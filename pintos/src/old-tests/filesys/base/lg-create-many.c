@@ -0,0 +1,49 @@
+/* Creates 10,000 empty files in the root directory and reports
+   the cycles taken per file for each thousand, which stay about
+   the same from first thousand to last if adding a file to a
+   directory takes constant time.  Then opens every file by name,
+   to check that all of them can be found, and checks that a name
+   that was never created cannot. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 10000
+#define BATCH_CNT 1000
+
+void
+test_main (void) 
+{
+  char name[16];
+  uint64_t start;
+  int i, fd;
+
+  start = rdtsc ();
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "f%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+      if ((i + 1) % BATCH_CNT == 0)
+        {
+          msg ("files %d-%d: %llu cycles per create", i + 1 - BATCH_CNT, i,
+               (unsigned long long) ((rdtsc () - start) / BATCH_CNT));
+          start = rdtsc ();
+        }
+    }
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "f%d", i);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      close (fd);
+    }
+  msg ("opened all %d files", FILE_CNT);
+
+  snprintf (name, sizeof name, "f%d", FILE_CNT);
+  if ((fd = open (name)) != -1)
+    fail ("open \"%s\" returned %d, but it was never created", name, fd);
+}
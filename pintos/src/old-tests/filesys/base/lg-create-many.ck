@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The cost per create varies from run to run.
+s/: \d+ cycles per create/: N cycles per create/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(lg-create-many) begin
+(lg-create-many) files 0-999: N cycles per create
+(lg-create-many) files 1000-1999: N cycles per create
+(lg-create-many) files 2000-2999: N cycles per create
+(lg-create-many) files 3000-3999: N cycles per create
+(lg-create-many) files 4000-4999: N cycles per create
+(lg-create-many) files 5000-5999: N cycles per create
+(lg-create-many) files 6000-6999: N cycles per create
+(lg-create-many) files 7000-7999: N cycles per create
+(lg-create-many) files 8000-8999: N cycles per create
+(lg-create-many) files 9000-9999: N cycles per create
+(lg-create-many) opened all 10000 files
+(lg-create-many) end
+lg-create-many: exit(0)
+EOF
+pass;
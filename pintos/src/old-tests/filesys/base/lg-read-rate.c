@@ -0,0 +1,59 @@
+/* Measures read throughput on a 128 kB file, which is larger
+   than the buffer cache, reading it once from start to end and
+   then once in random order, one 512-byte sector at a time, and
+   reports the cycles taken per kB.  The shutdown statistics show
+   how many reads hit the cache and how many sectors were read
+   ahead.  The file is never written, so afterward it is checked
+   to read back as all zeros. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (128 * 1024)
+#define BLOCK_SIZE 512
+#define BLOCK_CNT (FILE_SIZE / BLOCK_SIZE)
+
+static char buf[BLOCK_SIZE];
+static char zeros[FILE_SIZE];
+
+static void report (const char *name, uint64_t cycles);
+
+void
+test_main (void) 
+{
+  uint64_t start;
+  int fd;
+  size_t i;
+
+  CHECK (create ("data", FILE_SIZE), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+
+  start = rdtsc ();
+  for (i = 0; i < BLOCK_CNT; i++)
+    if (read (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+      fail ("read of block %zu failed", i);
+  report ("sequential", rdtsc () - start);
+
+  random_init (0);
+  start = rdtsc ();
+  for (i = 0; i < BLOCK_CNT; i++)
+    {
+      seek (fd, random_ulong () % BLOCK_CNT * BLOCK_SIZE);
+      if (read (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("random read %zu failed", i);
+    }
+  report ("random", rdtsc () - start);
+
+  close (fd);
+  check_file ("data", zeros, FILE_SIZE);
+}
+
+/* Reports reading the file in CYCLES cycles under NAME. */
+static void
+report (const char *name, uint64_t cycles) 
+{
+  msg ("%s read: %llu cycles per kB", name,
+       (unsigned long long) (cycles / (FILE_SIZE / 1024)));
+}
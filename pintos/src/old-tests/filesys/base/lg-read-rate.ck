@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The cost per kB varies from run to run.
+s/read: \d+ cycles per kB/read: N cycles per kB/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(lg-read-rate) begin
+(lg-read-rate) create "data"
+(lg-read-rate) open "data"
+(lg-read-rate) sequential read: N cycles per kB
+(lg-read-rate) random read: N cycles per kB
+(lg-read-rate) open "data" for verification
+(lg-read-rate) verified contents of "data"
+(lg-read-rate) close "data"
+(lg-read-rate) end
+lg-read-rate: exit(0)
+EOF
+pass;
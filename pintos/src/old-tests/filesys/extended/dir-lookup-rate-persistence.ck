@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($dir) = {};
+my ($root) = {"f" => ['/f'], "d" => $dir};
+for (my ($i) = 1; $i < 9; $i++) {
+    $dir = $dir->{"d"} = {};
+}
+$dir->{"f"} = ['/d/d/d/d/d/d/d/d/d/f'];
+check_archive ($root);
+pass;
@@ -0,0 +1,76 @@
+/* Measures how long it takes to look up a path one component
+   deep, "/f", and one ten components deep, "/d/d/d/d/d/d/d/d/d/f",
+   by opening and closing each of them many times, and reports
+   the cycles taken per open.  With the dentry cache, the deeper
+   path should cost little more than the shallow one.  Each file
+   holds its own path, so that afterward both paths can be checked
+   to lead to the right file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LOOKUP_CNT 1000
+
+static const char shallow[] = "/f";
+static const char deep[] = "/d/d/d/d/d/d/d/d/d/f";
+
+static void write_file (const char *name, const char *data);
+static void time_lookups (const char *path);
+
+void
+test_main (void) 
+{
+  int i;
+
+  CHECK (create ("f", 0), "create \"f\"");
+  write_file ("f", shallow);
+  for (i = 0; i < 9; i++)
+    {
+      CHECK (mkdir ("d"), "mkdir \"d\" at depth %d", i + 1);
+      CHECK (chdir ("d"), "chdir \"d\" at depth %d", i + 1);
+    }
+  CHECK (create ("f", 0), "create \"f\" at depth 10");
+  write_file ("f", deep);
+  CHECK (chdir ("/"), "chdir \"/\"");
+
+  time_lookups (shallow);
+  time_lookups (deep);
+
+  check_file (shallow, shallow, strlen (shallow));
+  check_file (deep, deep, strlen (deep));
+}
+
+/* Writes DATA into the empty file NAME. */
+static void
+write_file (const char *name, const char *data) 
+{
+  int size = strlen (data);
+  int fd;
+
+  if ((fd = open (name)) < 2)
+    fail ("open \"%s\" failed", name);
+  if (write (fd, data, size) != size)
+    fail ("write \"%s\" failed", name);
+  close (fd);
+}
+
+/* Opens and closes PATH LOOKUP_CNT times and reports the average
+   number of cycles per open and close. */
+static void
+time_lookups (const char *path) 
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < LOOKUP_CNT; i++)
+    {
+      int fd = open (path);
+      if (fd < 2)
+        fail ("open \"%s\" failed", path);
+      close (fd);
+    }
+  msg ("\"%s\": %llu cycles per lookup", path,
+       (unsigned long long) ((rdtsc () - start) / LOOKUP_CNT));
+}
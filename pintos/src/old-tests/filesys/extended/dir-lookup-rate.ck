@@ -0,0 +1,46 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The cost per lookup varies from run to run.
+s/: \d+ cycles per lookup/: N cycles per lookup/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(dir-lookup-rate) begin
+(dir-lookup-rate) create "f"
+(dir-lookup-rate) mkdir "d" at depth 1
+(dir-lookup-rate) chdir "d" at depth 1
+(dir-lookup-rate) mkdir "d" at depth 2
+(dir-lookup-rate) chdir "d" at depth 2
+(dir-lookup-rate) mkdir "d" at depth 3
+(dir-lookup-rate) chdir "d" at depth 3
+(dir-lookup-rate) mkdir "d" at depth 4
+(dir-lookup-rate) chdir "d" at depth 4
+(dir-lookup-rate) mkdir "d" at depth 5
+(dir-lookup-rate) chdir "d" at depth 5
+(dir-lookup-rate) mkdir "d" at depth 6
+(dir-lookup-rate) chdir "d" at depth 6
+(dir-lookup-rate) mkdir "d" at depth 7
+(dir-lookup-rate) chdir "d" at depth 7
+(dir-lookup-rate) mkdir "d" at depth 8
+(dir-lookup-rate) chdir "d" at depth 8
+(dir-lookup-rate) mkdir "d" at depth 9
+(dir-lookup-rate) chdir "d" at depth 9
+(dir-lookup-rate) create "f" at depth 10
+(dir-lookup-rate) chdir "/"
+(dir-lookup-rate) "/f": N cycles per lookup
+(dir-lookup-rate) "/d/d/d/d/d/d/d/d/d/f": N cycles per lookup
+(dir-lookup-rate) open "/f" for verification
+(dir-lookup-rate) verified contents of "/f"
+(dir-lookup-rate) close "/f"
+(dir-lookup-rate) open "/d/d/d/d/d/d/d/d/d/f" for verification
+(dir-lookup-rate) verified contents of "/d/d/d/d/d/d/d/d/d/f"
+(dir-lookup-rate) close "/d/d/d/d/d/d/d/d/d/f"
+(dir-lookup-rate) end
+dir-lookup-rate: exit(0)
+EOF
+pass;
@@ -0,0 +1,109 @@
+/* Creates 1,000 threads, each of which sleeps a different,
+   fixed duration several times, and reports how many CPU cycles
+   the sleepers consumed while doing so.
+
+   Sleeping threads should be blocked rather than spinning, so
+   nearly all of the elapsed time should be spent in the idle
+   thread. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/signal.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEPER_CNT 1000
+#define ITERATIONS 5
+
+/* Information about the test. */
+struct sleep_test 
+  {
+    int64_t start;              /* Current time at start of test. */
+    struct semaphore done;      /* Upped by each finished sleeper. */
+  };
+
+/* Information about an individual thread in the test. */
+struct sleep_thread 
+  {
+    struct sleep_test *test;    /* Info shared between all threads. */
+    int duration;               /* Number of ticks to sleep. */
+  };
+
+static void sleeper (void *);
+
+void
+test_alarm_cycles (void) 
+{
+  struct sleep_test test;
+  struct sleep_thread *threads;
+  int64_t start_idle, ticks, idle;
+  uint64_t start_tsc, cycles;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Don't report each child's exit. */
+  signal_ (SIG_CHLD, SIG_IGN);
+
+  msg ("Creating %d threads to sleep %d times each.",
+       SLEEPER_CNT, ITERATIONS);
+
+  threads = malloc (sizeof *threads * SLEEPER_CNT);
+  if (threads == NULL)
+    PANIC ("couldn't allocate memory for test");
+
+  test.start = timer_ticks () + 100;
+  sema_init (&test.done, 0);
+
+  for (i = 0; i < SLEEPER_CNT; i++)
+    {
+      struct sleep_thread *t = threads + i;
+      char name[16];
+
+      t->test = &test;
+      t->duration = (i % 10 + 1) * 10;
+
+      snprintf (name, sizeof name, "sleeper %d", i);
+      if (thread_create (name, PRI_DEFAULT, sleeper, t) == TID_ERROR)
+        fail ("couldn't create thread %d", i);
+    }
+
+  /* Measure from the first wakeup until the last sleeper is
+     done. */
+  timer_sleep (test.start - timer_ticks ());
+  start_tsc = rdtsc ();
+  start_idle = thread_idle_ticks ();
+  for (i = 0; i < SLEEPER_CNT; i++)
+    sema_down (&test.done);
+  cycles = rdtsc () - start_tsc;
+  ticks = timer_elapsed (test.start);
+  idle = thread_idle_ticks () - start_idle;
+
+  msg ("%d sleepers ran for %lld ticks, %lld of them idle.",
+       SLEEPER_CNT, ticks, idle);
+  msg ("Elapsed cycles: %llu.", cycles);
+  if (ticks > 0)
+    msg ("Cycles consumed by sleepers: %llu.",
+         cycles / ticks * (ticks - idle));
+
+  free (threads);
+  pass ();
+}
+
+/* Sleeper thread. */
+static void
+sleeper (void *t_) 
+{
+  struct sleep_thread *t = t_;
+  struct sleep_test *test = t->test;
+  int i;
+
+  timer_sleep (test->start - timer_ticks ());
+  for (i = 1; i <= ITERATIONS; i++) 
+    timer_sleep (test->start + i * t->duration - timer_ticks ());
+  sema_up (&test->done);
+}
@@ -0,0 +1,36 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The sleepers with the longest duration, 100 ticks, wake up for
+# the last time 500 ticks after the start.
+my ($ticks, $idle);
+foreach (@output) {
+    ($ticks, $idle) = /1000 sleepers ran for (\d+) ticks, (\d+) of them idle/
+      and last;
+}
+fail "missing tick count in output" if !defined $ticks;
+fail "sleepers ran for $ticks ticks, but the last one sleeps for 500"
+  if $ticks < 500;
+fail "$idle of $ticks ticks were idle" if $idle > $ticks;
+
+# The measurements themselves vary from run to run.
+foreach (@output) {
+    s/for \d+ ticks, \d+ of them/for N ticks, N of them/;
+    s/([Cc]ycles[a-z ]*): \d+\./$1: N./;
+}
+compare_output ("run", \@output, [<<'EOF']);
+(alarm-cycles) begin
+(alarm-cycles) Creating 1000 threads to sleep 5 times each.
+(alarm-cycles) 1000 sleepers ran for N ticks, N of them idle.
+(alarm-cycles) Elapsed cycles: N.
+(alarm-cycles) Cycles consumed by sleepers: N.
+(alarm-cycles) PASS
+(alarm-cycles) end
+EOF
+pass;
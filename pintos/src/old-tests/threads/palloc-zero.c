@@ -0,0 +1,102 @@
+/* Measures the latency of allocating zeroed pages, with and
+   without pages that the idle thread zeroed in advance, and
+   reports each distribution as a histogram with power-of-2
+   buckets.
+
+   The "cold" allocations come right after the pre-zeroed pages
+   have been used up, while this thread keeps the CPU busy so
+   that the idle thread cannot replace them, so each one must
+   zero its page itself.  The "warm" allocations come after a
+   sleep, during which the idle thread zeroes the pages freed in
+   the meantime. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_CNT 64
+#define BUCKET_CNT 24
+
+static void drain (void *pages[]);
+static void measure (const char *name, void *pages[]);
+static void free_pages (void *pages[]);
+
+void
+test_palloc_zero (void) 
+{
+  static void *spare[PAGE_CNT], *pages[PAGE_CNT];
+
+  drain (spare);
+  measure ("cold", pages);
+  free_pages (pages);
+  free_pages (spare);
+
+  timer_sleep (TIMER_FREQ / 10);
+  measure ("warm", pages);
+  free_pages (pages);
+  pass ();
+}
+
+/* Allocates PAGE_CNT zeroed pages into PAGES, which uses up any
+   pages that the idle thread has zeroed, without timing them. */
+static void
+drain (void *pages[]) 
+{
+  size_t i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    pages[i] = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+}
+
+/* Allocates PAGE_CNT zeroed pages into PAGES, timing each
+   allocation, checks that they are zeroed, and reports the
+   distribution of allocation times under NAME. */
+static void
+measure (const char *name, void *pages[]) 
+{
+  int buckets[BUCKET_CNT];
+  uint64_t total = 0;
+  size_t i, j;
+
+  memset (buckets, 0, sizeof buckets);
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      uint64_t start = rdtsc ();
+      uint64_t cycles;
+      int bucket;
+
+      pages[i] = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+      cycles = rdtsc () - start;
+      total += cycles;
+
+      for (bucket = 0; bucket < BUCKET_CNT - 1; bucket++)
+        if (cycles < (2ULL << bucket))
+          break;
+      buckets[bucket]++;
+    }
+
+  for (i = 0; i < PAGE_CNT; i++)
+    for (j = 0; j < PGSIZE; j++)
+      if (((uint8_t *) pages[i])[j] != 0)
+        fail ("%s page %zu: byte %zu is not zero", name, i, j);
+
+  msg ("%s: %d allocations, %llu cycles each on average.",
+       name, PAGE_CNT, total / PAGE_CNT);
+  for (i = 0; i < BUCKET_CNT; i++)
+    if (buckets[i] > 0)
+      msg ("%s: %d under %llu cycles", name, buckets[i], 2ULL << i);
+}
+
+/* Frees the PAGE_CNT pages in PAGES. */
+static void
+free_pages (void *pages[]) 
+{
+  size_t i;
+
+  for (i = 0; i < PAGE_CNT; i++)
+    palloc_free_page (pages[i]);
+}
@@ -0,0 +1,40 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Each histogram has buckets for ascending powers of 2 that
+# together hold all 64 allocations.  Which buckets are filled
+# varies from run to run.
+foreach my $name ('cold', 'warm') {
+    my ($total, $last) = (0, 0);
+    foreach (@output) {
+	my ($cnt, $limit) = /^\(palloc-zero\) $name: (\d+) under (\d+) cycles$/
+	  or next;
+	fail "$name: bucket for $limit cycles is not a power of 2 "
+	  . "between 2 and " . (2 << 23)
+	  if $limit < 2 || $limit > (2 << 23) || ($limit & ($limit - 1));
+	fail "$name: bucket for $limit cycles follows bucket for $last"
+	  if $limit <= $last;
+	fail "$name: bucket for $limit cycles is empty" if $cnt == 0;
+	$total += $cnt;
+	$last = $limit;
+    }
+    fail "$name: histogram holds $total allocations instead of 64"
+      if $total != 64;
+}
+
+@output = grep (!/^\(palloc-zero\) \w+: \d+ under \d+ cycles$/, @output);
+s/allocations, \d+ cycles/allocations, N cycles/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) cold: 64 allocations, N cycles each on average.
+(palloc-zero) warm: 64 allocations, N cycles each on average.
+(palloc-zero) PASS
+(palloc-zero) end
+EOF
+pass;
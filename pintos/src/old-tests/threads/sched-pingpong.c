@@ -0,0 +1,59 @@
+/* Measures context-switch latency by making control "ping-pong"
+   between a pair of threads with semaphores, and reports the
+   average number of CPU cycles per switch. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/signal.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define ROUND_TRIPS 10000
+
+static void pong (void *sema_);
+
+void
+test_sched_pingpong (void) 
+{
+  struct semaphore sema[2];
+  uint64_t start, cycles;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Don't report each child's exit. */
+  signal_ (SIG_CHLD, SIG_IGN);
+
+  sema_init (&sema[0], 0);
+  sema_init (&sema[1], 0);
+  thread_create ("pong", PRI_DEFAULT, pong, &sema);
+
+  start = rdtsc ();
+  for (i = 0; i < ROUND_TRIPS; i++) 
+    {
+      sema_up (&sema[0]);
+      sema_down (&sema[1]);
+    }
+  cycles = rdtsc () - start;
+
+  msg ("%d round trips in %llu cycles.", ROUND_TRIPS, cycles);
+  msg ("Average: %llu cycles per context switch.",
+       cycles / (2 * ROUND_TRIPS));
+  pass ();
+}
+
+/* Returns control to the other thread each time it is woken. */
+static void
+pong (void *sema_) 
+{
+  struct semaphore *sema = sema_;
+  int i;
+
+  for (i = 0; i < ROUND_TRIPS; i++) 
+    {
+      sema_down (&sema[0]);
+      sema_up (&sema[1]);
+    }
+}
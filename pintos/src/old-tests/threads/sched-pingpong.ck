@@ -0,0 +1,30 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Each round trip is two context switches.
+my ($cycles, $average);
+foreach (@output) {
+    $cycles = $1 if /round trips in (\d+) cycles\./;
+    $average = $1 if /Average: (\d+) cycles per context switch\./;
+}
+fail "missing cycle counts in output"
+  if !defined $cycles || !defined $average;
+fail "average of $average cycles per switch does not match "
+  . "$cycles cycles for 20000 switches"
+  if $average != int ($cycles / 20000);
+
+s/(in|Average:) \d+ cycles/$1 N cycles/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(sched-pingpong) begin
+(sched-pingpong) 10000 round trips in N cycles.
+(sched-pingpong) Average: N cycles per context switch.
+(sched-pingpong) PASS
+(sched-pingpong) end
+EOF
+pass;
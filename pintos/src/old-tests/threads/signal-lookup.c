@@ -0,0 +1,85 @@
+/* Creates 2,000 threads and sends signals to them at random,
+   reporting the average number of CPU cycles per kill().  With
+   an indexed tid lookup and cached ancestor checks, the cost per
+   signal should not depend on the number of threads. */
+
+#include <stdio.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/signal.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 2000
+#define SIGNAL_CNT 20000
+
+static void blocker (void *sema_);
+static void send_signals (const tid_t *, int signum, const char *name);
+
+void
+test_signal_lookup (void) 
+{
+  struct semaphore sema;
+  tid_t *tids;
+  int i;
+
+  tids = malloc (sizeof *tids * THREAD_CNT);
+  if (tids == NULL)
+    PANIC ("couldn't allocate memory for test");
+
+  /* Don't report each child's exit. */
+  signal_ (SIG_CHLD, SIG_IGN);
+
+  /* Create threads that block until the end of the test, so that
+     the handlers of the signals they receive run only when they
+     are woken up, after the signals have all been sent. */
+  sema_init (&sema, 0);
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "blocker %d", i);
+      tids[i] = thread_create (name, PRI_DEFAULT, blocker, &sema);
+      if (tids[i] == TID_ERROR)
+        fail ("couldn't create thread %d", i);
+    }
+  timer_sleep (10);
+  msg ("Created %d threads.", THREAD_CNT);
+
+  random_init (0);
+  send_signals (tids, SIG_USR, "SIG_USR");
+  send_signals (tids, SIG_KILL, "SIG_KILL");
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_up (&sema);
+  timer_sleep (10);
+
+  free (tids);
+  pass ();
+}
+
+/* Sends SIGNAL_CNT signals SIGNUM to random threads in TIDS and
+   reports the average cost. */
+static void
+send_signals (const tid_t *tids, int signum, const char *name) 
+{
+  uint64_t start, cycles;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < SIGNAL_CNT; i++)
+    if (kill (tids[random_ulong () % THREAD_CNT], signum) != 0)
+      fail ("%s to thread failed", name);
+  cycles = rdtsc () - start;
+
+  msg ("%s: %llu cycles per signal.", name, cycles / SIGNAL_CNT);
+}
+
+/* Blocks on the semaphore SEMA_. */
+static void
+blocker (void *sema_) 
+{
+  sema_down (sema_);
+}
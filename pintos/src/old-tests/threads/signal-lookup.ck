@@ -0,0 +1,40 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Each blocker runs its handlers once, when it is woken up at the
+# end: SIG_USR first, if it received one, then SIG_KILL, which
+# makes it exit.  All of the signals come from the same thread.
+my (%usr, %kill, %senders);
+foreach (@output) {
+    my ($signal, $sender, $receiver)
+      = /^SIG_(USR|KILL) from thread (\d+) to (\d+)$/ or next;
+    my ($received) = $signal eq 'USR' ? \%usr : \%kill;
+    fail "thread $receiver ran its SIG_$signal handler twice"
+      if $received->{$receiver}++;
+    fail "thread $receiver ran its SIG_USR handler after SIG_KILL"
+      if $signal eq 'USR' && $kill{$receiver};
+    $senders{$sender} = 1;
+}
+fail "no thread ran its SIG_USR handler" if !%usr;
+fail "no thread ran its SIG_KILL handler" if !%kill;
+fail "signals came from more than one thread" if keys (%senders) > 1;
+fail "more than 2000 threads received signals"
+  if keys (%usr) > 2000 || keys (%kill) > 2000;
+
+@output = grep (!/^SIG_(USR|KILL) from thread \d+ to \d+$/, @output);
+s/: \d+ cycles per signal/: N cycles per signal/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(signal-lookup) begin
+(signal-lookup) Created 2000 threads.
+(signal-lookup) SIG_USR: N cycles per signal.
+(signal-lookup) SIG_KILL: N cycles per signal.
+(signal-lookup) PASS
+(signal-lookup) end
+EOF
+pass;
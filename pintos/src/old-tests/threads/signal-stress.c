@@ -0,0 +1,68 @@
+/* Sends 100,000 SIG_USR signals to a thread, letting it run
+   every so often so that the pending signals are delivered, and
+   reports kernel pool usage before and after.
+
+   Pending signals are kept in a fixed per-thread bitmap, so
+   sending and delivering signals should not consume any kernel
+   memory. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/signal.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SIGNAL_CNT 100000
+#define DELIVERY_INTERVAL 1000
+
+static void receiver (void *done_);
+
+void
+test_signal_stress (void) 
+{
+  volatile bool done = false;
+  size_t free_before, free_after;
+  tid_t tid;
+  int i;
+
+  /* Don't report each child's exit. */
+  signal_ (SIG_CHLD, SIG_IGN);
+
+  free_before = palloc_free_cnt (0);
+  msg ("Kernel pool pages free before: %zu.", free_before);
+
+  tid = thread_create ("receiver", PRI_DEFAULT, receiver, (void *) &done);
+  if (tid == TID_ERROR)
+    fail ("couldn't create receiver thread");
+
+  for (i = 1; i <= SIGNAL_CNT; i++)
+    {
+      if (kill (tid, SIG_USR) != 0)
+        fail ("kill() failed on signal %d", i);
+      if (i % DELIVERY_INTERVAL == 0)
+        thread_yield ();
+    }
+  msg ("Sent %d SIG_USR signals.", SIGNAL_CNT);
+
+  /* Let the receiver exit and its page be freed. */
+  done = true;
+  timer_sleep (10);
+
+  free_after = palloc_free_cnt (0);
+  msg ("Kernel pool pages free after: %zu.", free_after);
+  if (free_after < free_before)
+    fail ("%zu kernel pages leaked", free_before - free_after);
+  pass ();
+}
+
+/* Receives signals until *DONE_ becomes true. */
+static void
+receiver (void *done_) 
+{
+  volatile bool *done = done_;
+
+  while (!*done)
+    thread_yield ();
+}
@@ -0,0 +1,47 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Every page that was free before the signals were sent must be
+# free again afterward.
+my ($free_before, $free_after);
+foreach (@output) {
+    $free_before = $1 if /pages free before: (\d+)\./;
+    $free_after = $1 if /pages free after: (\d+)\./;
+}
+fail "missing kernel pool usage in output"
+  if !defined $free_before || !defined $free_after;
+if ($free_after < $free_before) {
+    my ($leaked) = $free_before - $free_after;
+    fail "$leaked kernel pages leaked";
+}
+
+# Pending signals of a kind are merged, so the receiver runs its
+# handler at least once but usually far fewer than 100,000 times,
+# always for the same sender.
+my (%pairs);
+foreach (@output) {
+    $pairs{"$1 $2"}++ if /^SIG_USR from thread (\d+) to (\d+)$/;
+}
+fail "SIG_USR handler never ran" if !%pairs;
+fail "SIG_USR handler ran for more than one sender and receiver"
+  if keys (%pairs) > 1;
+my ($sender, $receiver) = split (' ', (keys %pairs)[0]);
+fail "thread $sender sent SIG_USR to itself" if $sender == $receiver;
+
+@output = grep (!/^SIG_USR from thread \d+ to \d+$/, @output);
+s/free (before|after): \d+/free $1: N/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(signal-stress) begin
+(signal-stress) Kernel pool pages free before: N.
+(signal-stress) Sent 100000 SIG_USR signals.
+(signal-stress) Kernel pool pages free after: N.
+(signal-stress) PASS
+(signal-stress) end
+EOF
+pass;
@@ -0,0 +1,80 @@
+/* Sends SIG_UBLOCK to a thread asleep in timer_sleep(), which
+   must wake it up early and take it out of the sleeping-thread
+   wheel, and to a thread waiting on a semaphore, which must be
+   refused, since the semaphore still expects to wake it.  Then
+   sleeps past the first thread's original wakeup tick, by which
+   time that thread has exited, to check that the timer interrupt
+   no longer knows about it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/signal.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEP_TICKS 100
+
+static void sleeper (void *);
+static void waiter (void *);
+
+static struct semaphore done;
+static struct semaphore never;
+
+void
+test_signal_ublock (void)
+{
+  tid_t sleeper_tid, waiter_tid;
+
+  /* Don't report each child's exit. */
+  signal_ (SIG_CHLD, SIG_IGN);
+
+  sema_init (&done, 0);
+  sema_init (&never, 0);
+  sleeper_tid = thread_create ("sleeper", PRI_DEFAULT, sleeper, NULL);
+  waiter_tid = thread_create ("waiter", PRI_DEFAULT, waiter, NULL);
+  if (sleeper_tid == TID_ERROR || waiter_tid == TID_ERROR)
+    fail ("couldn't create threads");
+
+  /* Let both threads block. */
+  timer_sleep (10);
+
+  if (kill (waiter_tid, SIG_UBLOCK) != -1)
+    fail ("SIG_UBLOCK to a semaphore waiter was not refused");
+  msg ("SIG_UBLOCK to the waiter was refused.");
+
+  if (kill (sleeper_tid, SIG_UBLOCK) != 0)
+    fail ("SIG_UBLOCK to a sleeper failed");
+  sema_down (&done);
+
+  /* Sleep past the sleeper's original wakeup tick. */
+  timer_sleep (SLEEP_TICKS + 10);
+
+  sema_up (&never);
+  sema_down (&done);
+  pass ();
+}
+
+/* Sleeps for SLEEP_TICKS ticks, reporting whether it was woken
+   up early. */
+static void
+sleeper (void *aux UNUSED)
+{
+  int64_t start = timer_ticks ();
+
+  timer_sleep (SLEEP_TICKS);
+  if (timer_elapsed (start) >= SLEEP_TICKS)
+    fail ("sleeper slept for all %d ticks", SLEEP_TICKS);
+  msg ("Sleeper woke up early.");
+  sema_up (&done);
+}
+
+/* Waits on a semaphore that is only upped at the end. */
+static void
+waiter (void *aux UNUSED)
+{
+  sema_down (&never);
+  msg ("Waiter woke up.");
+  sema_up (&done);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(signal-ublock) begin
+(signal-ublock) SIG_UBLOCK to the waiter was refused.
+(signal-ublock) Sleeper woke up early.
+(signal-ublock) Waiter woke up.
+(signal-ublock) PASS
+(signal-ublock) end
+EOF
+pass;
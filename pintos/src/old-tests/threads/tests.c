@@ -17,6 +17,8 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-cycles", test_alarm_cycles},
+    {"tick-cost", test_tick_cost},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -38,6 +40,12 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"signal-stress", test_signal_stress},
+    {"sched-pingpong", test_sched_pingpong},
+    {"signal-lookup", test_signal_lookup},
+    {"signal-ublock", test_signal_ublock},
+    {"thread-create-rate", test_thread_create_rate},
+    {"palloc-zero", test_palloc_zero},
   };
 
 static const char *test_name;
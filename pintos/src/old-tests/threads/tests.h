@@ -1,6 +1,8 @@
 #ifndef TESTS_THREADS_TESTS_H
 #define TESTS_THREADS_TESTS_H
 
+#include <stdint.h>
+
 void run_test (const char *);
 
 typedef void test_func (void);
@@ -11,6 +13,8 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_cycles;
+extern test_func test_tick_cost;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -32,10 +36,25 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_signal_stress;
+extern test_func test_sched_pingpong;
+extern test_func test_signal_lookup;
+extern test_func test_signal_ublock;
+extern test_func test_thread_create_rate;
+extern test_func test_palloc_zero;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
 void pass (void);
 
+/* Returns the CPU's time-stamp counter, for benchmarks. */
+static inline uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
 #endif /* tests/threads/tests.h */
 
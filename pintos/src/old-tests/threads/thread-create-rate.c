@@ -0,0 +1,57 @@
+/* Creates 10,000 short-lived threads, one after another, and
+   reports thread create/exit throughput in threads per second.
+   Each thread has a higher priority than the creator, so it runs
+   and exits before thread_create() returns. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/signal.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 10000
+
+static void quick (void *counter_);
+
+void
+test_thread_create_rate (void) 
+{
+  volatile int counter = 0;
+  uint64_t start_tsc, cycles;
+  int64_t start, ticks;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Don't report each child's exit. */
+  signal_ (SIG_CHLD, SIG_IGN);
+
+  start = timer_ticks ();
+  start_tsc = rdtsc ();
+  for (i = 0; i < THREAD_CNT; i++)
+    if (thread_create ("quick", PRI_DEFAULT + 1, quick,
+                       (void *) &counter) == TID_ERROR)
+      fail ("couldn't create thread %d", i);
+  cycles = rdtsc () - start_tsc;
+  ticks = timer_elapsed (start);
+
+  if (counter != THREAD_CNT)
+    fail ("only %d of %d threads ran", counter, THREAD_CNT);
+
+  msg ("Created and exited %d threads in %lld ticks.", THREAD_CNT, ticks);
+  msg ("Average: %llu cycles per thread.", cycles / THREAD_CNT);
+  if (ticks > 0)
+    msg ("Throughput: %lld threads/second.",
+         THREAD_CNT * TIMER_FREQ / ticks);
+  pass ();
+}
+
+/* Counts itself and exits. */
+static void
+quick (void *counter_) 
+{
+  volatile int *counter = counter_;
+  (*counter)++;
+}
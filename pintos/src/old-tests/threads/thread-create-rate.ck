@@ -0,0 +1,46 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Throughput is reported, at 100 ticks per second, only if at
+# least one tick elapsed.
+my ($ticks, $throughput);
+foreach (@output) {
+    $ticks = $1 if /threads in (\d+) ticks\./;
+    $throughput = $1 if /Throughput: (\d+) threads\/second\./;
+}
+fail "missing tick count in output" if !defined $ticks;
+if ($ticks > 0) {
+    my ($expected) = int (10000 * 100 / $ticks);
+    fail "missing throughput in output" if !defined $throughput;
+    fail "throughput of $throughput threads/second does not match "
+      . "10000 threads in $ticks ticks"
+      if $throughput != $expected;
+} elsif (defined $throughput) {
+    fail "throughput reported for a run of 0 ticks";
+}
+
+foreach (@output) {
+    s/in \d+ ticks/in N ticks/;
+    s/(Average|Throughput): \d+/$1: N/;
+}
+compare_output ("run", \@output, [<<'EOF', <<'EOF']);
+(thread-create-rate) begin
+(thread-create-rate) Created and exited 10000 threads in N ticks.
+(thread-create-rate) Average: N cycles per thread.
+(thread-create-rate) Throughput: N threads/second.
+(thread-create-rate) PASS
+(thread-create-rate) end
+EOF
+(thread-create-rate) begin
+(thread-create-rate) Created and exited 10000 threads in N ticks.
+(thread-create-rate) Average: N cycles per thread.
+(thread-create-rate) PASS
+(thread-create-rate) end
+EOF
+pass;
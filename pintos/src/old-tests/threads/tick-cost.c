@@ -0,0 +1,90 @@
+/* Measures the cost of the timer interrupt as the number of
+   threads in the system grows.
+
+   For each thread count, creates that many threads blocked on a
+   semaphore, then spins for a fixed number of ticks reading the
+   time-stamp counter.  Cycles that cannot be accounted for by
+   the spin loop itself were spent handling timer interrupts.
+   The per-tick cost should not depend on the thread count. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/signal.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SPIN_TICKS 100
+
+static void blocker (void *sema_);
+static void measure (int thread_cnt);
+
+void
+test_tick_cost (void) 
+{
+  static const int thread_cnts[] = {0, 250, 500, 1000};
+  size_t i;
+
+  /* Don't report each child's exit. */
+  signal_ (SIG_CHLD, SIG_IGN);
+
+  for (i = 0; i < sizeof thread_cnts / sizeof *thread_cnts; i++)
+    measure (thread_cnts[i]);
+  pass ();
+}
+
+/* Reports the timer interrupt cost with THREAD_CNT extra
+   threads. */
+static void
+measure (int thread_cnt) 
+{
+  struct semaphore sema;
+  uint64_t start_tsc, prev, min_delta, loops;
+  int64_t start;
+  int i;
+
+  sema_init (&sema, 0);
+  for (i = 0; i < thread_cnt; i++)
+    {
+      char name[sizeof "blocker " + 11];
+      snprintf (name, sizeof name, "blocker %d", i);
+      if (thread_create (name, PRI_DEFAULT, blocker, &sema) == TID_ERROR)
+        fail ("couldn't create thread %d", i);
+    }
+
+  /* Let all the blockers run and block. */
+  timer_sleep (10);
+
+  /* Spin, starting at the beginning of a tick. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+  start = timer_ticks ();
+  min_delta = UINT64_MAX;
+  loops = 0;
+  start_tsc = prev = rdtsc ();
+  while (timer_elapsed (start) < SPIN_TICKS)
+    {
+      uint64_t now = rdtsc ();
+      if (now - prev < min_delta)
+        min_delta = now - prev;
+      prev = now;
+      loops++;
+    }
+
+  msg ("%d threads: %llu cycles per tick in timer interrupt.",
+       thread_cnt, (prev - start_tsc - loops * min_delta) / SPIN_TICKS);
+
+  /* Release the blockers and let them exit. */
+  for (i = 0; i < thread_cnt; i++)
+    sema_up (&sema);
+  timer_sleep (10);
+}
+
+/* Blocks on the semaphore SEMA_. */
+static void
+blocker (void *sema_) 
+{
+  sema_down (sema_);
+}
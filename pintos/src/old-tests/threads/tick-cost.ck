@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The cost of a tick varies from run to run.
+s/threads: \d+ cycles/threads: N cycles/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(tick-cost) begin
+(tick-cost) 0 threads: N cycles per tick in timer interrupt.
+(tick-cost) 250 threads: N cycles per tick in timer interrupt.
+(tick-cost) 500 threads: N cycles per tick in timer interrupt.
+(tick-cost) 1000 threads: N cycles per tick in timer interrupt.
+(tick-cost) PASS
+(tick-cost) end
+EOF
+pass;
@@ -0,0 +1,31 @@
+/* Tries to execute a process with more arguments than fit on
+   its stack.  The command line itself fits in a page, but its
+   argv[] array would not fit alongside the argument strings.
+   The exec system call must return -1. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ARG_CNT 1400
+
+static char cmd_line[sizeof "child-simple" + 2 * ARG_CNT];
+
+void
+test_main (void) 
+{
+  char *p = cmd_line;
+  int i;
+
+  strlcpy (p, "child-simple", sizeof cmd_line);
+  p += strlen (p);
+  for (i = 0; i < ARG_CNT; i++)
+    {
+      *p++ = ' ';
+      *p++ = 'x';
+    }
+  *p = '\0';
+
+  msg ("exec(\"child-simple x x ...\"): %d", exec (cmd_line));
+}
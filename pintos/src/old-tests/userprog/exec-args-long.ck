@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF', <<'EOF']);
+(exec-args-long) begin
+(exec-args-long) exec("child-simple x x ..."): -1
+(exec-args-long) end
+exec-args-long: exit(0)
+EOF
+(exec-args-long) begin
+child-simple: exit(-1)
+(exec-args-long) exec("child-simple x x ..."): -1
+(exec-args-long) end
+exec-args-long: exit(0)
+EOF
+(exec-args-long) begin
+(exec-args-long) exec("child-simple x x ..."): -1
+child-simple: exit(-1)
+(exec-args-long) end
+exec-args-long: exit(0)
+EOF
+pass;
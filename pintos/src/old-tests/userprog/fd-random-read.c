@@ -0,0 +1,66 @@
+/* Opens sample.txt 4,096 times, then reads it a byte at a time
+   through randomly chosen descriptors and reports the cycles per
+   read.  Since descriptors index an array, the cost of a read
+   should not depend on how many files the process has open.
+   Reports a checksum of the bytes read, in the order read, so
+   that they can be checked against sample.txt.  Also checks that
+   a closed descriptor is the next one reused, and leaves every
+   file open for process_exit() to close. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/cksum.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 4096
+#define READ_CNT 10000
+
+static int fds[FILE_CNT];
+static size_t positions[FILE_CNT];
+static char bytes[READ_CNT];
+
+void
+test_main (void) 
+{
+  uint64_t start, cycles;
+  size_t byte_cnt;
+  int i, fd;
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      fds[i] = open ("sample.txt");
+      if (fds[i] < 2)
+        fail ("open #%d returned %d", i, fds[i]);
+    }
+  msg ("opened \"sample.txt\" %d times", FILE_CNT);
+
+  fd = fds[FILE_CNT / 2];
+  close (fd);
+  fds[FILE_CNT / 2] = open ("sample.txt");
+  if (fds[FILE_CNT / 2] != fd)
+    fail ("reopen returned %d, not freed descriptor %d",
+          fds[FILE_CNT / 2], fd);
+
+  byte_cnt = 0;
+  start = rdtsc ();
+  for (i = 0; i < READ_CNT; i++)
+    {
+      size_t idx = random_ulong () % FILE_CNT;
+      char c;
+
+      if (positions[idx] >= sizeof sample - 1)
+        continue;
+      if (read (fds[idx], &c, 1) != 1)
+        fail ("read from fd %d failed", fds[idx]);
+      if (c != sample[positions[idx]++])
+        fail ("read wrong byte from fd %d", fds[idx]);
+      bytes[byte_cnt++] = c;
+    }
+  cycles = rdtsc () - start;
+
+  msg ("%d random-descriptor reads took %llu cycles each",
+       READ_CNT, (unsigned long long) (cycles / READ_CNT));
+  msg ("read %zu bytes: cksum=%lu", byte_cnt, cksum (bytes, byte_cnt));
+}
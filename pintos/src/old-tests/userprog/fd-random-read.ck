@@ -0,0 +1,43 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::cksum;
+use tests::random;
+
+my ($sample) = <<'EOF';
+"Amazing Electronic Fact: If you scuffed your feet long enough without
+ touching anything, you would build up so many electrons that your
+ finger would explode!  But this is nothing to worry about unless you
+ have carpeting." --Dave Barry
+EOF
+
+# Replay the reads: each one takes the next byte of sample.txt
+# through a random one of 4,096 descriptors, unless that
+# descriptor is already at end of file.
+my (@positions) = (0) x 4096;
+my ($bytes) = "";
+random_init (0);
+for my $i (1...10000) {
+    my ($idx) = random_ulong () % 4096;
+    next if $positions[$idx] >= length ($sample);
+    $bytes .= substr ($sample, $positions[$idx]++, 1);
+}
+my ($byte_cnt) = length ($bytes);
+my ($cksum) = cksum ($bytes);
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The cost per read varies from run to run.
+s/took \d+ cycles each/took N cycles each/ foreach @output;
+compare_output ("run", \@output, [<<EOF]);
+(fd-random-read) begin
+(fd-random-read) opened "sample.txt" 4096 times
+(fd-random-read) 10000 random-descriptor reads took N cycles each
+(fd-random-read) read $byte_cnt bytes: cksum=$cksum
+(fd-random-read) end
+fd-random-read: exit(0)
+EOF
+pass;
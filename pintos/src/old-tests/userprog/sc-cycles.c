@@ -0,0 +1,28 @@
+/* Measures the cost of entering and leaving the kernel through
+   a system call, in cycles per call.  wait() on a process id
+   that is not a child of the caller returns -1 at once, so
+   nearly all of its cost is the dispatch itself: the trap, the
+   copying in of the system call number and argument, the table
+   lookup, and the return to user mode. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CALL_CNT 100000
+
+void
+test_main (void) 
+{
+  uint64_t start, cycles;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < CALL_CNT; i++)
+    if (wait (-1) != -1)
+      fail ("wait(-1) did not return -1");
+  cycles = rdtsc () - start;
+
+  msg ("%d null system calls took %llu cycles each",
+       CALL_CNT, (unsigned long long) (cycles / CALL_CNT));
+}
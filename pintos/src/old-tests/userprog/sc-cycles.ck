@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The cost per call varies from run to run.
+s/took \d+ cycles each/took N cycles each/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(sc-cycles) begin
+(sc-cycles) 100000 null system calls took N cycles each
+(sc-cycles) end
+sc-cycles: exit(0)
+EOF
+pass;
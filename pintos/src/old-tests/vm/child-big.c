@@ -0,0 +1,15 @@
+/* Child process run by exec-lazy.
+   Has a 256 kB initialized array in its data segment, which it
+   never touches. */
+
+#include "tests/lib.h"
+
+const char *test_name = "child-big";
+
+char big[256 * 1024] = {1};
+
+int
+main (void) 
+{
+  return 0;
+}
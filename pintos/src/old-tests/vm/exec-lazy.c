@@ -0,0 +1,32 @@
+/* Measures how long it takes to exec and wait for a child with
+   a large data segment that it never touches.  With demand
+   paging, the untouched pages are never read from disk, so the
+   cost should be close to that of a small program rather than
+   growing with the size of the executable. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define EXEC_CNT 10
+
+void
+test_main (void) 
+{
+  uint64_t start, cycles;
+  int i;
+
+  start = rdtsc ();
+  for (i = 0; i < EXEC_CNT; i++)
+    {
+      pid_t child = exec ("child-big");
+      if (child == PID_ERROR)
+        fail ("exec(\"child-big\") failed");
+      if (wait (child) != 0)
+        fail ("child-big exited with wrong status");
+    }
+  cycles = rdtsc () - start;
+
+  msg ("exec and wait of child-big took %llu cycles each",
+       (unsigned long long) (cycles / EXEC_CNT));
+}
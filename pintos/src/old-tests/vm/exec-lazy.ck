@@ -0,0 +1,40 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# child-big never touches its 256 kB array, so with demand paging
+# the whole run reads fewer pages from files than just one copy
+# of the array, 64 pages, would take.
+my ($file_pages);
+foreach (@output) {
+    $file_pages = $1, last if /^Paging: (\d+) pages read from files,/;
+}
+fail "missing paging statistics in output" if !defined $file_pages;
+fail "$file_pages pages read from files, but child-big's array alone "
+  . "is 64 pages and is never touched"
+  if $file_pages >= 64;
+
+# The cost per exec varies from run to run.
+s/took \d+ cycles each/took N cycles each/ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(exec-lazy) begin
+child-big: exit(0)
+child-big: exit(0)
+child-big: exit(0)
+child-big: exit(0)
+child-big: exit(0)
+child-big: exit(0)
+child-big: exit(0)
+child-big: exit(0)
+child-big: exit(0)
+child-big: exit(0)
+(exec-lazy) exec and wait of child-big took N cycles each
+(exec-lazy) end
+exec-lazy: exit(0)
+EOF
+pass;
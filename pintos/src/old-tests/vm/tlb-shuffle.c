@@ -0,0 +1,64 @@
+/* Measures the cost of paging operations that change the page
+   tables and so must keep the TLB in step with them.  First
+   shuffles a 128 kB buffer, which touches its pages in random
+   order and so is sensitive to TLB misses, such as those after
+   each needless flush of the TLB, and reports the checksum of the
+   result, which is the same as page-shuffle's after its last
+   shuffle.  Then repeatedly maps a 64-page file, reads every page
+   of it, and unmaps it, which clears 64 page table entries at
+   once. */
+
+#include <syscall.h>
+#include "tests/cksum.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (128 * 1024)
+#define SHUFFLE_CNT 10
+
+#define MAP_PAGES 64
+#define MAP_CNT 20
+#define ACTUAL ((char *) 0x10000000)
+
+static char buf[SIZE];
+
+void
+test_main (void)
+{
+  uint64_t start, cycles;
+  unsigned long sum;
+  int handle;
+  size_t i, j;
+
+  /* Shuffle. */
+  for (i = 0; i < sizeof buf; i++)
+    buf[i] = i * 257;
+  start = rdtsc ();
+  for (i = 0; i < SHUFFLE_CNT; i++)
+    shuffle (buf, sizeof buf, 1);
+  cycles = rdtsc () - start;
+  msg ("shuffle took %llu cycles each",
+       (unsigned long long) (cycles / SHUFFLE_CNT));
+  msg ("shuffled: cksum=%lu", cksum (buf, sizeof buf));
+
+  /* Map, touch, and unmap. */
+  CHECK (create ("zeros", MAP_PAGES * 4096), "create \"zeros\"");
+  CHECK ((handle = open ("zeros")) > 1, "open \"zeros\"");
+  sum = 0;
+  start = rdtsc ();
+  for (i = 0; i < MAP_CNT; i++)
+    {
+      mapid_t map = mmap (handle, ACTUAL);
+      if (map == MAP_FAILED)
+        fail ("mmap \"zeros\" failed");
+      for (j = 0; j < MAP_PAGES; j++)
+        sum += ACTUAL[j * 4096];
+      munmap (map);
+    }
+  cycles = rdtsc () - start;
+  if (sum != 0)
+    fail ("\"zeros\" is not all zeros");
+  msg ("mapping %d pages took %llu cycles each time",
+       MAP_PAGES, (unsigned long long) (cycles / MAP_CNT));
+  close (handle);
+}
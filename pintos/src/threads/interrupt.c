@@ -386,6 +386,15 @@ intr_handler (struct intr_frame *frame)
       if (yield_on_return) 
         thread_yield (); 
     }
+
+  /* Deliver pending signals before returning to user mode, with
+     interrupts on. */
+  if ((frame->cs & 3) == 3 && thread_current ()->pending_signals != 0)
+    {
+      enum intr_level old_level = intr_enable ();
+      signal_dispatch ();
+      intr_set_level (old_level);
+    }
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
@@ -2,11 +2,13 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,7 +25,16 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Up to ZERO_POOL_MAX single pages freed to each pool are not
+   returned to its bitmap but parked on a list, where the idle
+   thread zeroes them (see palloc_zero_idle()) so that PAL_ZERO
+   requests need not.  The lists are shared with the idle thread,
+   which must never block, so they are protected by disabling
+   interrupts rather than by the pool's lock.  Each parked page
+   holds its own list element in its first bytes. */
+#define ZERO_POOL_MAX 64
 
 /* A memory pool. */
 struct pool
@@ -31,6 +42,11 @@ struct pool
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+
+    /* Parked pages, marked used in USED_MAP. */
+    struct list dirty;                  /* Freed pages to be zeroed. */
+    struct list zeroed;                 /* Zeroed pages. */
+    size_t parked_cnt;                  /* Pages parked, or being zeroed. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +55,10 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static bool park (struct pool *, void *page);
+static void *unpark (struct pool *, struct list *);
+static void unpark_all (struct pool *);
+static bool zero_one (struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -66,7 +86,12 @@ palloc_init (size_t user_page_limit)
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
    then the pages are filled with zeros.  If too few pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   FLAGS, in which case the kernel panics.
+
+   A single page comes from the pool's parked pages when there is
+   a suitable one: a zeroed page for PAL_ZERO, otherwise a page
+   still waiting to be zeroed, so as not to waste the idle
+   thread's work. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
@@ -77,8 +102,21 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   if (page_cnt == 0)
     return NULL;
 
+  if (page_cnt == 1)
+    {
+      pages = unpark (pool, flags & PAL_ZERO ? &pool->zeroed : &pool->dirty);
+      if (pages != NULL)
+        return pages;
+    }
+
   lock_acquire (&pool->lock);
   page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+  if (page_idx == BITMAP_ERROR && pool->parked_cnt > 0)
+    {
+      /* The parked pages may be just what is missing. */
+      unpark_all (pool);
+      page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+    }
   lock_release (&pool->lock);
 
   if (page_idx != BITMAP_ERROR)
@@ -113,7 +151,8 @@ palloc_get_page (enum palloc_flags flags)
   return palloc_get_multiple (flags, 1);
 }
 
-/* Frees the PAGE_CNT pages starting at PAGES. */
+/* Frees the PAGE_CNT pages starting at PAGES.  A single page is
+   parked for the idle thread to zero, if there is room. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
@@ -138,6 +177,8 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 #endif
 
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+  if (page_cnt == 1 && park (pool, pages))
+    return;
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
 }
 
@@ -148,6 +189,34 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of free pages in the user pool if PAL_USER
+   is set in FLAGS, otherwise in the kernel pool. */
+size_t
+palloc_free_cnt (enum palloc_flags flags) 
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  size_t cnt;
+
+  lock_acquire (&pool->lock);
+  cnt = bitmap_count (pool->used_map, 0, bitmap_size (pool->used_map),
+                      false);
+  cnt += pool->parked_cnt;
+  lock_release (&pool->lock);
+
+  return cnt;
+}
+
+/* Zeroes one parked page, if there is one waiting.  Returns true
+   if it zeroed a page, false if there was none to zero.  Called
+   by the idle thread, so it never blocks.  Interrupts are enabled
+   while the page is zeroed, so that the idle thread can be
+   preempted as usual, and restored afterward. */
+bool
+palloc_zero_idle (void) 
+{
+  return zero_one (&kernel_pool) || zero_one (&user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
@@ -167,6 +236,9 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   lock_init (&p->lock);
   p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
   p->base = base + bm_pages * PGSIZE;
+  list_init (&p->dirty);
+  list_init (&p->zeroed);
+  p->parked_cnt = 0;
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -180,3 +252,86 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Adds PAGE, a page of POOL that is being freed, to POOL's list
+   of pages to be zeroed.  Returns true if successful, false if
+   POOL already has ZERO_POOL_MAX parked pages. */
+static bool
+park (struct pool *pool, void *page) 
+{
+  enum intr_level old_level;
+  bool parked = false;
+
+  old_level = intr_disable ();
+  if (pool->parked_cnt < ZERO_POOL_MAX)
+    {
+      list_push_back (&pool->dirty, page);
+      pool->parked_cnt++;
+      parked = true;
+    }
+  intr_set_level (old_level);
+  return parked;
+}
+
+/* Removes a page from LIST, one of POOL's lists of parked pages,
+   and returns it, or returns a null pointer if LIST is empty.
+   A page from the `zeroed' list is entirely zero on return. */
+static void *
+unpark (struct pool *pool, struct list *list) 
+{
+  struct list_elem *page = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (!list_empty (list))
+    {
+      page = list_pop_front (list);
+      pool->parked_cnt--;
+    }
+  intr_set_level (old_level);
+
+  if (page != NULL && list == &pool->zeroed)
+    memset (page, 0, sizeof *page);
+  return page;
+}
+
+/* Returns all of POOL's parked pages to its bitmap.  POOL's lock
+   must be held. */
+static void
+unpark_all (struct pool *pool) 
+{
+  uint8_t *page;
+
+  ASSERT (lock_held_by_current_thread (&pool->lock));
+
+  while ((page = unpark (pool, &pool->dirty)) != NULL
+         || (page = unpark (pool, &pool->zeroed)) != NULL)
+    bitmap_reset (pool->used_map, pg_no (page) - pg_no (pool->base));
+}
+
+/* Zeroes one of POOL's pages waiting to be zeroed and moves it
+   to its `zeroed' list.  Returns true if successful, false if
+   no page was waiting. */
+static bool
+zero_one (struct pool *pool) 
+{
+  struct list_elem *page;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (list_empty (&pool->dirty))
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+
+  /* While it is zeroed, the page is on neither list but still
+     counted in PARKED_CNT. */
+  page = list_pop_front (&pool->dirty);
+  intr_enable ();
+  memset (page, 0, PGSIZE);
+  intr_disable ();
+  list_push_back (&pool->zeroed, page);
+  intr_set_level (old_level);
+  return true;
+}
@@ -13,6 +13,7 @@
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -54,103 +55,123 @@ int signal_(int signum, int handler)
     return 0;
 }
 
+/* A signal being sent by kill(). */
+struct kill_request
+{
+    struct thread* sender;      /* Sending thread. */
+    int signum;                 /* Signal number. */
+    int result;                 /* Return value for kill(). */
+};
+
 /**
- * Send signal signum to process tid
+ * Deliver the signal described by REQUEST_ to thread t.
+ * Runs under thread_for_tid(), so t cannot exit meanwhile.
  */
-int kill(int tid, int signum)
+static void kill_thread(struct thread* t, void* request_)
 {
-    struct thread* t = validated_tid(tid);
-    if (t == NULL)
-        return -1;
+    struct kill_request* request = request_;
+    int signum = request->signum;
 
+    request->result = -1;
     if (signum == SIG_UBLOCK)
     {
         unsigned short tmp_sigmask = (t->sigmask) & 4;
         if (tmp_sigmask !=0)
-            return -1;
-        else if (t->status != THREAD_BLOCKED)
-            return 0;
-
-        list_push_back (&unblock_list, &t->unblock_elem);
+            return;
+
+        /* Only a thread asleep in timer_sleep() can be woken early.
+           Any other blocked thread is on a wait list, such as a
+           semaphore's, that still expects to wake it. */
+        enum intr_level old_level = intr_disable ();
+        bool refused = t->status == THREAD_BLOCKED && !timer_wake (t);
+        intr_set_level (old_level);
+        if (refused)
+            return;
     }
 
     else if (signum == SIG_USR)
     {
-        struct signal* sig;
-        bool is_sig_usr = false;
         unsigned short tmp_sigmask = (t->sigmask) & 8;
         if (tmp_sigmask != 0)
-            return -1;
-
-        for (struct list_elem* tmp_elem = list_begin (&t->pending_signals); tmp_elem != list_end (&t->pending_signals);
-             tmp_elem = list_next (tmp_elem))
-        {
-            sig = list_entry (tmp_elem, struct signal, elem);
-            if(sig->signum == (unsigned) signum)
-            {
-                sig->sender = thread_current()->tid;
-                is_sig_usr = true;
-                break;
-            }
-        }
-
-        if (!is_sig_usr)
-        {
-            sig = (struct signal*) malloc(1 * sizeof(struct signal));
-            sig->sender = thread_current()->tid;
-            sig->signum = signum;
-            list_push_back (&t->pending_signals, &sig->elem);
-        }
+            return;
+
+        signal_post (t, signum, request->sender->tid);
     }
 
     else if (signum == SIG_KILL)
     {
-        struct signal* sig;
-        bool parent_found = false;
-        bool prev_sig_kill = false;
-        struct thread* tmp_thread = t;
-
-        for (;;)
-        {
-            if (thread_current()->tid == tmp_thread->parent_thread->tid)
-            {
-                parent_found = true;
-                break;
-            }
-
-            if(tmp_thread->parent_thread->tid == 1)
-                break;
-
-            tmp_thread = tmp_thread->parent_thread;
-        }
-
-        if(!parent_found)
-            return -1;
-
-        for (struct list_elem* tmp_elem = list_begin (&t->pending_signals); tmp_elem != list_end (&t->pending_signals);
-             tmp_elem = list_next (tmp_elem))
-        {
-            sig = list_entry (tmp_elem, struct signal, elem);
-            if(sig->signum == (unsigned) signum)
-            {
-                prev_sig_kill = true;
-                sig->sender = thread_current()->tid;
-                break;
-            }
-        }
-
-        if (!prev_sig_kill)
-        {
-            sig = (struct signal*) malloc(1 * sizeof(struct signal));
-            sig->sender = thread_current()->tid;
-            sig->signum = signum;
-            list_push_back (&t->pending_signals, &sig->elem);
-        }
+        if (!thread_is_ancestor (request->sender, t))
+            return;
+
+        signal_post (t, signum, request->sender->tid);
     }
 
     else
+        return;
+    request->result = 0;
+}
+
+/**
+ * Send signal signum to process tid
+ */
+int kill(int tid, int signum)
+{
+    struct kill_request request;
+
+    request.sender = thread_current();
+    request.signum = signum;
+    request.result = -1;
+    if (!thread_for_tid (tid, kill_thread, &request))
         return -1;
-    return 0;
+    return request.result;
+}
+
+/**
+ * Mark signal signum pending for thread t, sent by sender.
+ * A signal that is already pending is not queued twice; only
+ * its sender is updated.  Never allocates memory.
+ */
+void signal_post(struct thread* t, int signum, int sender)
+{
+    ASSERT (signum >= 0 && signum < SIG_CNT);
+
+    enum intr_level old_level = intr_disable ();
+    t->signal_senders[signum] = sender;
+    t->pending_signals |= 1 << signum;
+    intr_set_level (old_level);
+}
+
+/**
+ * Run the handlers of the current thread's pending signals.
+ * This is the only place signals are delivered.  It is called
+ * before an interrupt returns to user mode, and when a thread
+ * resumes after yielding or sleeping in thread_yield(),
+ * sema_down() or timer_sleep(), never from the context switch
+ * itself.  Signals are delivered only with interrupts on and no
+ * locks held, so handlers may print or exit freely; otherwise
+ * they stay pending until the next such point.
+ */
+void signal_dispatch(void)
+{
+    struct thread* t = thread_current();
+
+    if (t->pending_signals == 0 || intr_get_level () == INTR_OFF
+        || !list_empty (&t->held_locks))
+        return;
+
+    enum intr_level old_level = intr_disable ();
+    unsigned short pending = t->pending_signals;
+    t->pending_signals = 0;
+    intr_set_level (old_level);
+
+    if (pending & (1 << SIG_CHLD))
+        CHLD_handler(t->signal_senders[SIG_CHLD]);
+    if (pending & (1 << SIG_USR))
+        USR_handler(t->signal_senders[SIG_USR]);
+    if (pending & (1 << SIG_CPU))
+        CPU_handler();
+    if (pending & (1 << SIG_KILL))
+        KILL_handler(t->signal_senders[SIG_KILL]);
 }
 
 /**
@@ -220,9 +241,9 @@ int sigprocmask(int how, const sigset_t* set, sigset_t* oldset)
 
 void CHLD_handler(int sender)
 {
-    printf("SIG_CHLD from thread %d to %d", sender, thread_current()->tid);
+    printf("SIG_CHLD from thread %d to %d\n", sender, thread_current()->tid);
     thread_current()->alive_children--;
-    printf("Total children created: %d; Children alive: %d", thread_current()->total_children,
+    printf("Total children created: %d; Children alive: %d\n", thread_current()->total_children,
            thread_current()->alive_children);
 }
 
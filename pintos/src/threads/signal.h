@@ -3,10 +3,11 @@
 
 #include <stdint.h>
 #include <debug.h>
-#include <list.h>
 
 typedef unsigned short sigset_t;
 
+struct thread;
+
 enum sig_value
 {
     SIG_CHLD = 0,
@@ -16,6 +17,9 @@ enum sig_value
     SIG_KILL = 4
 };
 
+/* Number of signal types. */
+#define SIG_CNT 5
+
 enum how
 {
     SIG_BLOCK = 0,
@@ -29,13 +33,6 @@ enum sig_handler
     SIG_DFL = 1
 };
 
-struct signal
-{
-    enum sig_value signum;      /* Signal type value. */
-    struct list_elem elem;      /* List element added to signal lists. */
-    int sender;
-};
-
 /* Signal handler functions. */
 void CHLD_handler(int sender);
 void KILL_handler(int sender);
@@ -45,6 +42,10 @@ void USR_handler(int sender);
 int signal_(int signum, int handler);
 int kill(int tid, int signum);
 
+/* Signal delivery. */
+void signal_post(struct thread* t, int signum, int sender);
+void signal_dispatch(void);
+
 /* Signal masking functions. */
 int sigemptyset(sigset_t *set);
 int sigfillset(sigset_t *set);
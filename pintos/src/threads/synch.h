@@ -20,8 +20,12 @@ void sema_self_test (void);
 /* Lock. */
 struct lock 
   {
-    struct thread *holder;      /* Thread holding lock (for debugging). */
+    struct thread *holder;      /* Thread holding lock. */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+
+    /* Priority donation. */
+    struct list_elem elem;      /* Element in holder's held_locks list. */
+    int max_priority;           /* Highest priority among waiters. */
   };
 
 void lock_init (struct lock *);
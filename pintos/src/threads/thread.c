@@ -13,6 +13,7 @@
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -22,14 +23,27 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running.  There is one FIFO
+   queue per priority, and bit P of ready_bitmap is set exactly
+   when ready_queues[P] is nonempty, so that the highest-priority
+   ready thread can be found with a single bit scan. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_bitmap;
+static int ready_cnt;           /* Total number of ready threads. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
+/* Pages of dead threads, kept for reuse by thread_create() so
+   that creating a thread does not have to go through palloc's
+   bitmap search.  Cached pages are linked through their old
+   `allelem' members.  Protected by disabling interrupts. */
+#define THREAD_CACHE_MAX 32
+static struct list thread_cache;
+static size_t thread_cache_cnt;
+
 /* Idle thread. */
 static struct thread *idle_thread;
 
@@ -39,6 +53,20 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Index of live threads by tid, for thread_for_tid().  It is
+   set up by thread_start(), because hash tables need malloc().
+   A thread leaves the index, under tid_index_lock, before it
+   starts to die, so holding the lock keeps every indexed thread
+   alive. */
+static struct hash tid_index;
+static struct lock tid_index_lock;
+
+/* Incremented whenever a dying thread hands its children to its
+   own parent, which is the only way that ancestry changes.
+   Cached thread_is_ancestor() results from older generations are
+   discarded. */
+static unsigned lineage_gen;
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -56,24 +84,77 @@ static long long user_ticks;    /* # of timer ticks in user programs. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
-struct list unblock_list;
-
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* Multi-level feedback queue scheduler state.
+
+   Once a second, every thread's recent_cpu decays by a factor
+   that depends on the load average at that moment.  Rather than
+   walking all threads to apply it, the factor is recorded in
+   decay_history, indexed by the second it applies to, and each
+   thread replays the factors it missed when it is next made
+   ready.  Only the running and ready threads are updated eagerly.
+   A thread that stays blocked for longer than DECAY_HISTORY
+   seconds skips its oldest factors, by which point they have
+   long since decayed its recent_cpu to insignificance.
+
+   A second's update takes recent_cpu to decay * recent_cpu +
+   nice, so the updates for a run of seconds combine into one
+   that takes it to scale * recent_cpu + weight * nice.
+   decay_blocks holds the combined update for each aligned block
+   of DECAY_BLOCK seconds, so that catching up replays at most
+   DECAY_BLOCK - 1 single seconds at each end and one step per
+   whole block in between: no more than 2 * (DECAY_BLOCK - 1) +
+   DECAY_HISTORY / DECAY_BLOCK = 94 fixed-point multiply-adds,
+   however long the thread was blocked.  That is the most that
+   unblocking a thread, possibly from an interrupt handler, adds
+   to the time spent with interrupts off.  The combined factors
+   are kept with DECAY_BLOCK_SHIFT fraction bits, rather than
+   the 14 of fixed_point, so that a block step loses no more
+   precision than a single second does. */
+#define DECAY_HISTORY 1024              /* Must be a power of 2. */
+#define DECAY_BLOCK 32                  /* Must be a power of 2. */
+#define DECAY_BLOCK_CNT (DECAY_HISTORY / DECAY_BLOCK)
+#define DECAY_BLOCK_SHIFT 30
+#define DECAY_BLOCK_ONE ((int64_t) 1 << DECAY_BLOCK_SHIFT)
+static fixed_point load_avg;            /* System load average. */
+static int mlfqs_seconds;               /* Seconds since boot. */
+static fixed_point decay_history[DECAY_HISTORY];
+
+/* Combined update for a block of seconds. */
+struct decay_block
+  {
+    int64_t scale;                      /* Factor applied to recent_cpu. */
+    int64_t weight;                     /* Factor applied to nice. */
+  };
+static struct decay_block decay_blocks[DECAY_BLOCK_CNT];
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
+static struct thread *thread_page_get (void);
+static void thread_page_put (struct thread *);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
+static void ready_queue_push (struct thread *);
+static void ready_queue_remove (struct thread *);
+static struct thread *ready_queue_pop (void);
+static int ready_max_priority (void);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_second (struct thread *);
+static void mlfqs_catch_up (struct thread *);
+static void mlfqs_update_priority (struct thread *);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static hash_hash_func tid_hash;
+static hash_less_func tid_less;
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -91,12 +172,16 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  lock_init (&tid_index_lock);
+  for (i = 0; i <= PRI_MAX; i++)
+    list_init (&ready_queues[i]);
   list_init (&all_list);
-  list_init (&unblock_list);
+  list_init (&thread_cache);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -112,6 +197,11 @@ thread_start (void)
 {
   /* Create the idle thread. */
   struct semaphore idle_started;
+
+  /* Index the initial thread, the only one so far. */
+  hash_init (&tid_index, tid_hash, tid_less, NULL);
+  hash_insert (&tid_index, &initial_thread->tid_elem);
+
   sema_init (&idle_started, 0);
   thread_create ("idle", PRI_MIN, idle, &idle_started);
 
@@ -139,15 +229,25 @@ thread_tick (void)
   else
     kernel_ticks++;
 
-  for (struct list_elem* elem = list_begin (&all_list); elem != list_end (&all_list); elem = list_next (elem))
-  {
-      struct thread* t = list_entry (elem, struct thread, allelem);
-      t->thread_total_time += 1;
+  if (thread_mlfqs)
+    mlfqs_tick (t);
 
-      unsigned short tmp_sigmask = (t->sigmask) & 2;
-      if (t->thread_life_time != -1 && t->thread_total_time >= t->thread_life_time && tmp_sigmask == 0)
+  /* Only the running thread accrues CPU time, so it is the only
+     thread that can reach the end of its lifetime on this tick.
+     Once it does, raise SIG_CPU and make it yield, so that the
+     signal is delivered as it resumes. */
+  if (t != idle_thread)
+    {
+      t->thread_total_time++;
+      if (t->thread_life_time != -1 && !t->is_life_over
+          && t->thread_total_time >= t->thread_life_time
+          && (t->sigmask & 2) == 0)
+        {
           t->is_life_over = true;
-  }
+          signal_post (t, SIG_CPU, t->tid);
+          intr_yield_on_return ();
+        }
+    }
 
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
@@ -162,6 +262,17 @@ thread_print_stats (void)
           idle_ticks, kernel_ticks, user_ticks);
 }
 
+/* Returns the number of timer ticks spent in the idle thread
+   since boot. */
+int64_t
+thread_idle_ticks (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  int64_t t = idle_ticks;
+  intr_set_level (old_level);
+  return t;
+}
+
 /* Creates a new kernel thread named NAME with the given initial
    PRIORITY, which executes FUNCTION passing AUX as the argument,
    and adds it to the ready queue.  Returns the thread identifier
@@ -174,9 +285,8 @@ thread_print_stats (void)
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   The new thread preempts the running thread right away if
+   PRIORITY is higher than the running thread's priority. */
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux) 
@@ -191,7 +301,7 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = thread_page_get ();
   if (t == NULL)
     return TID_ERROR;
 
@@ -199,6 +309,10 @@ thread_create (const char *name, int priority,
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
 
+  lock_acquire (&tid_index_lock);
+  hash_insert (&tid_index, &t->tid_elem);
+  lock_release (&tid_index_lock);
+
   if (tid > 0)
   {
       thread_current()->total_children += 1;
@@ -231,6 +345,7 @@ thread_create (const char *name, int priority,
 
   /* Add to run queue. */
   thread_unblock (t);
+  thread_preempt ();
 
   return tid;
 }
@@ -258,7 +373,10 @@ thread_block (void)
    This function does not preempt the running thread.  This can
    be important: if the caller had disabled interrupts itself,
    it may expect that it can atomically unblock a thread and
-   update other data. */
+   update other data.  Callers that want T to run right away if
+   it outranks the running thread should call thread_preempt()
+   afterward.  The one exception is an interrupt handler, for
+   which preemption is deferred until the handler returns. */
 void
 thread_unblock (struct thread *t) 
 {
@@ -268,8 +386,12 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  if (thread_mlfqs)
+    mlfqs_catch_up (t);
+  ready_queue_push (t);
   t->status = THREAD_READY;
+  if (intr_context () && t->priority > running_thread ()->priority)
+    intr_yield_on_return ();
   intr_set_level (old_level);
 }
 
@@ -306,23 +428,51 @@ thread_tid (void)
   return thread_current ()->tid;
 }
 
-/* Check and return thread pointer for valid tid. */
-struct thread*
-validated_tid (int tid)
+/* Invokes FUNC on the live thread whose tid is TID, passing
+   along AUX, and returns true, or returns false if there is no
+   such thread.  The thread cannot exit until FUNC returns, but
+   FUNC must not block on anything that the thread might hold,
+   or create or exit a thread itself. */
+bool
+thread_for_tid (tid_t tid, thread_action_func *func, void *aux)
 {
-    struct thread* t = NULL;
-    for (struct list_elem* elem = list_begin (&all_list); elem != list_end (&all_list); elem = list_next (elem))
-    {
-        t = list_entry (elem, struct thread, allelem);
-        if (tid == t-> tid)
-            break;
-        else
-        {
-            t = NULL;
-            continue;
-        }
-    }
-    return t;
+  struct thread key;
+  struct hash_elem *e;
+
+  key.tid = tid;
+  lock_acquire (&tid_index_lock);
+  e = hash_find (&tid_index, &key.tid_elem);
+  if (e != NULL)
+    func (hash_entry (e, struct thread, tid_elem), aux);
+  lock_release (&tid_index_lock);
+  return e != NULL;
+}
+
+/* Returns true if ANCESTOR is T's parent, or its parent's
+   parent, and so on.  The answer is cached in T, so repeated
+   checks against the same ancestor do not walk the parent chain
+   until the lineage next changes. */
+bool
+thread_is_ancestor (struct thread *ancestor, struct thread *t)
+{
+  struct thread *p;
+  bool result = false;
+
+  if (t->ancestor_cache_gen == lineage_gen
+      && t->ancestor_cache_tid == ancestor->tid)
+    return t->ancestor_cache_result;
+
+  for (p = t->parent_thread; p != NULL; p = p->parent_thread)
+    if (p == ancestor)
+      {
+        result = true;
+        break;
+      }
+
+  t->ancestor_cache_tid = ancestor->tid;
+  t->ancestor_cache_result = result;
+  t->ancestor_cache_gen = lineage_gen;
+  return result;
 }
 
 /* Deschedules the current thread and destroys it.  Never
@@ -333,6 +483,8 @@ thread_exit (void)
     if (thread_current()->tid > 0 && thread_current()->tid != 1)
     {
         struct thread* parent = thread_current()->parent_thread;
+        if (!list_empty (&thread_current()->children_list))
+            lineage_gen++;
         for (struct list_elem* elem = list_begin (&thread_current()->children_list);
              elem != list_end (&thread_current()->children_list); elem = list_next (elem))
         {
@@ -344,40 +496,22 @@ thread_exit (void)
         if (thread_current()->is_parent == true)
             list_remove (&thread_current()->child_elem);
 
-        unsigned short tmp_sigmask = (parent->sigmask) & 1;
-        if (thread_current()->is_parent && tmp_sigmask == 0)
-        {
-            list_remove (&thread_current()->child_elem);
-            struct signal* s;
-            bool prev_sig_child = false;
-            for (struct list_elem* e = list_begin (&parent->pending_signals); e != list_end (&parent->pending_signals);
-                 e = list_next (e))
-            {
-                s = list_entry (e, struct signal, elem);
-                if (s->signum != 0)
-                {
-                    continue;
-                }
-                else
-                {
-                    prev_sig_child = true;
-                    s->sender = thread_current()->tid;
-                    break;
-                }
-            }
-
-            if(!prev_sig_child)
-            {
-                s = (struct signal*) malloc(1 * sizeof(struct signal));
-                s->sender = thread_current()->tid;
-                s->signum = 0;
-                list_push_back (&parent->pending_signals, &s->elem);
-            }
-        }
+        bool notify = thread_current()->is_parent && (parent->sigmask & 1) == 0;
+#ifdef USERPROG
+        /* A user process reports its exit through its exit record. */
+        if (thread_current()->exit_record != NULL)
+            notify = false;
+#endif
+        if (notify)
+            signal_post (parent, SIG_CHLD, thread_current()->tid);
     }
 
     ASSERT (!intr_context ());
 
+  lock_acquire (&tid_index_lock);
+  hash_delete (&tid_index, &thread_current ()->tid_elem);
+  lock_release (&tid_index_lock);
+
 #ifdef USERPROG
   process_exit ();
 #endif
@@ -393,7 +527,12 @@ thread_exit (void)
 }
 
 /* Yields the CPU.  The current thread is not put to sleep and
-   may be scheduled again immediately at the scheduler's whim. */
+   may be scheduled again immediately at the scheduler's whim.
+
+   Signals that arrived while the current thread was not running
+   are delivered when it resumes here, unless interrupts were off
+   when it yielded, as when an interrupt handler preempts it; the
+   interrupt's return to user mode delivers them instead. */
 void
 thread_yield (void) 
 {
@@ -404,10 +543,13 @@ thread_yield (void)
 
   old_level = intr_disable ();
   if (cur != idle_thread) 
-    list_push_back (&ready_list, &cur->elem);
+    ready_queue_push (cur);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
+
+  if (old_level == INTR_ON)
+    signal_dispatch ();
 }
 
 /* Invoke function 'func' on all threads, passing along 'aux'.
@@ -427,11 +569,83 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Yields the CPU if some ready thread has a higher priority than
+   the running thread.  In an interrupt handler, the yield is
+   deferred until the handler returns. */
+void
+thread_preempt (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  bool outranked = ready_max_priority () > running_thread ()->priority;
+  intr_set_level (old_level);
+
+  if (!outranked)
+    return;
+  if (intr_context ())
+    intr_yield_on_return ();
+  else
+    thread_yield ();
+}
+
+/* Sets the current thread's base priority to NEW_PRIORITY,
+   yielding if it no longer has the highest priority.  Priority
+   donations still in effect are not affected.  Ignored under the
+   multi-level feedback queue scheduler, which computes priorities
+   itself. */
 void
 thread_set_priority (int new_priority) 
 {
-  thread_current ()->priority = new_priority;
+  struct thread *cur = thread_current ();
+
+  ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+  if (thread_mlfqs)
+    return;
+  cur->base_priority = new_priority;
+  thread_update_priority (cur);
+  thread_preempt ();
+}
+
+/* Recomputes T's effective priority as the maximum of its base
+   priority and the priorities donated to it through the locks it
+   holds, moving T to its new ready queue if it is ready.  Does
+   not preempt the running thread.  Does nothing under the
+   multi-level feedback queue scheduler, which does not use
+   donation. */
+void
+thread_update_priority (struct thread *t) 
+{
+  enum intr_level old_level;
+  struct list_elem *e;
+  int priority;
+
+  ASSERT (is_thread (t));
+
+  if (thread_mlfqs)
+    return;
+
+  old_level = intr_disable ();
+  priority = t->base_priority;
+  for (e = list_begin (&t->held_locks); e != list_end (&t->held_locks);
+       e = list_next (e))
+    {
+      struct lock *lock = list_entry (e, struct lock, elem);
+      if (lock->max_priority > priority)
+        priority = lock->max_priority;
+    }
+
+  if (priority != t->priority)
+    {
+      if (t->status == THREAD_READY && t != idle_thread)
+        {
+          ready_queue_remove (t);
+          t->priority = priority;
+          ready_queue_push (t);
+        }
+      else
+        t->priority = priority;
+    }
+  intr_set_level (old_level);
 }
 
 /* Returns the current thread's priority. */
@@ -441,35 +655,187 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE and recomputes
+   its priority, yielding if it no longer has the highest
+   priority. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_set_nice (int nice) 
 {
-  /* Not yet implemented. */
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  if (thread_mlfqs)
+    mlfqs_update_priority (cur);
+  intr_set_level (old_level);
+  thread_preempt ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load_avg_100 = fp_round (fp_mul_int (load_avg, 100));
+  intr_set_level (old_level);
+  return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu_100 = fp_round (fp_mul_int (thread_current ()->recent_cpu,
+                                             100));
+  intr_set_level (old_level);
+  return recent_cpu_100;
+}
+
+/* Does the multi-level feedback queue scheduler's bookkeeping
+   for a timer tick during which CUR was running.  Only CUR's
+   recent_cpu changes between whole seconds, so only CUR's
+   priority needs recomputing every fourth tick. */
+static void
+mlfqs_tick (struct thread *cur) 
+{
+  int64_t ticks = timer_ticks ();
+
+  ASSERT (intr_context ());
+
+  if (cur != idle_thread)
+    cur->recent_cpu = fp_add_int (cur->recent_cpu, 1);
+
+  if (ticks % TIMER_FREQ == 0)
+    mlfqs_second (cur);
+  else if (ticks % 4 == 0 && cur != idle_thread)
+    mlfqs_update_priority (cur);
+
+  if (ready_max_priority () > cur->priority)
+    intr_yield_on_return ();
+}
+
+/* Updates the load average and decays recent_cpu, once per
+   second.  CUR is the running thread.  The running thread and
+   the ready threads are updated right away and requeued by
+   their new priorities; blocked threads catch up when they are
+   unblocked.
+
+   Ready threads are always current, so each costs only one
+   multiply-add and one requeue here.  With interrupts off, this
+   takes time proportional to the number of ready threads, once
+   a second. */
+static void
+mlfqs_second (struct thread *cur) 
+{
+  int ready_threads = ready_cnt + (cur != idle_thread ? 1 : 0);
+  fixed_point twice_load, decay;
+  struct decay_block *block;
+  struct list moved;
+  int priority;
+
+  load_avg = fp_div_int (fp_add_int (fp_mul_int (load_avg, 59),
+                                     ready_threads), 60);
+  twice_load = fp_mul_int (load_avg, 2);
+  decay = fp_div (twice_load, fp_add_int (twice_load, 1));
+  mlfqs_seconds++;
+  decay_history[mlfqs_seconds & (DECAY_HISTORY - 1)] = decay;
+
+  /* Fold this second into its block's combined update. */
+  block = &decay_blocks[(mlfqs_seconds / DECAY_BLOCK)
+                        & (DECAY_BLOCK_CNT - 1)];
+  if (mlfqs_seconds % DECAY_BLOCK == 0)
+    {
+      block->scale = DECAY_BLOCK_ONE;
+      block->weight = 0;
+    }
+  block->scale = block->scale * decay / FP_ONE;
+  block->weight = block->weight * decay / FP_ONE + DECAY_BLOCK_ONE;
+
+  if (cur != idle_thread)
+    mlfqs_catch_up (cur);
+
+  /* Pull every ready thread out of the ready queues, in priority
+     order, then put each one back under its new priority. */
+  list_init (&moved);
+  for (priority = PRI_MAX; priority >= PRI_MIN; priority--)
+    {
+      struct list *queue = &ready_queues[priority];
+      if (!list_empty (queue))
+        list_splice (list_end (&moved), list_begin (queue), list_end (queue));
+    }
+  ready_bitmap = 0;
+  ready_cnt = 0;
+  while (!list_empty (&moved))
+    {
+      struct thread *t = list_entry (list_pop_front (&moved),
+                                     struct thread, elem);
+      mlfqs_catch_up (t);
+      ready_queue_push (t);
+    }
+}
+
+/* Applies to T's recent_cpu the per-second decays that it has
+   missed since it was last brought up to date, then recomputes
+   its priority.  Whole blocks of missed seconds are applied in
+   one step each.  Interrupts must be off. */
+static void
+mlfqs_catch_up (struct thread *t) 
+{
+  int missed = mlfqs_seconds - t->recent_cpu_epoch;
+  int second;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (missed > DECAY_HISTORY)
+    missed = DECAY_HISTORY;
+  second = mlfqs_seconds - missed + 1;
+  while (second <= mlfqs_seconds)
+    if (second % DECAY_BLOCK == 0
+        && second + DECAY_BLOCK - 1 <= mlfqs_seconds)
+      {
+        const struct decay_block *block
+          = &decay_blocks[(second / DECAY_BLOCK) & (DECAY_BLOCK_CNT - 1)];
+        t->recent_cpu = (block->scale * t->recent_cpu
+                         + block->weight * fp_from_int (t->nice))
+                        / DECAY_BLOCK_ONE;
+        second += DECAY_BLOCK;
+      }
+    else
+      {
+        fixed_point decay = decay_history[second & (DECAY_HISTORY - 1)];
+        t->recent_cpu = fp_add_int (fp_mul (decay, t->recent_cpu),
+                                    t->nice);
+        second++;
+      }
+  t->recent_cpu_epoch = mlfqs_seconds;
+  mlfqs_update_priority (t);
+}
+
+/* Recomputes T's priority from its recent_cpu and nice values.
+   Does not move T between ready queues, so T must not be in
+   one. */
+static void
+mlfqs_update_priority (struct thread *t) 
+{
+  int priority = PRI_MAX - fp_trunc (fp_div_int (t->recent_cpu, 4))
+                 - t->nice * 2;
+
+  if (priority < PRI_MIN)
+    priority = PRI_MIN;
+  else if (priority > PRI_MAX)
+    priority = PRI_MAX;
+  t->priority = priority;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -494,6 +860,15 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* With nothing else to do, zero freed pages ahead of the
+         PAL_ZERO requests that will want them.  Any thread that
+         becomes ready preempts us as usual, but stop anyway once
+         one is ready, in case it could not. */
+      while (ready_bitmap == 0 && palloc_zero_idle ())
+        continue;
+      if (ready_bitmap != 0)
+        continue;
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -555,21 +930,94 @@ init_thread (struct thread *t, const char *name, int priority)
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
-  t->priority = priority;
+  t->priority = t->base_priority = priority;
+  list_init (&t->held_locks);
   t->magic = THREAD_MAGIC;
 
+  /* Under the multi-level feedback queue scheduler, a new thread
+     inherits its creator's nice and recent_cpu values, and its
+     priority follows from them.  (The initial thread "inherits"
+     from itself, that is, from the zeroes just stored.) */
+  if (thread_mlfqs)
+    {
+      struct thread *creator = running_thread ();
+      t->nice = creator->nice;
+      t->recent_cpu = creator->recent_cpu;
+      t->recent_cpu_epoch = mlfqs_seconds;
+      mlfqs_update_priority (t);
+    }
+
   /* Set initial values for thread parameters. */
   list_init (&t->children_list);
-  list_init (&t->pending_signals);
   t->thread_total_time = 0;
   t->thread_life_time = -1;
   t->is_life_over = false;
   t->is_parent = true;
   t->sigmask = 0;
+#ifdef USERPROG
+  t->exit_record = NULL;
+  t->child_records = NULL;
+  t->executable = NULL;
+  t->files = NULL;
+  t->fd_map = NULL;
+  t->fd_cnt = 0;
+#endif
+#ifdef VM
+  t->pages = NULL;
+  t->user_esp = NULL;
+  list_init (&t->mappings);
+  t->next_mapping_id = 0;
+#endif
 
   list_push_back (&all_list, &t->allelem);
 }
 
+/* Returns a page for a new thread, recycling the page of a dead
+   thread if one is cached.  The page is not zeroed: init_thread()
+   initializes the `struct thread' at its bottom, and the kernel
+   stack above it needs no initialization.  Returns a null pointer
+   if no page is available. */
+static struct thread *
+thread_page_get (void) 
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (!list_empty (&thread_cache))
+    {
+      t = list_entry (list_pop_front (&thread_cache), struct thread, allelem);
+      thread_cache_cnt--;
+    }
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    t = palloc_get_page (0);
+  return t;
+}
+
+/* Releases the page of dead thread T, caching it for reuse unless
+   the cache is full. */
+static void
+thread_page_put (struct thread *t) 
+{
+  enum intr_level old_level;
+
+  ASSERT (t->status == THREAD_DYING);
+
+  old_level = intr_disable ();
+  if (thread_cache_cnt < THREAD_CACHE_MAX)
+    {
+      list_push_front (&thread_cache, &t->allelem);
+      thread_cache_cnt++;
+      t = NULL;
+    }
+  intr_set_level (old_level);
+
+  if (t != NULL)
+    palloc_free_page (t);
+}
+
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
    returns a pointer to the frame's base. */
 static void *
@@ -583,6 +1031,70 @@ alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
+/* Adds T to the back of the ready queue for its priority.
+   Interrupts must be off. */
+static void
+ready_queue_push (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  list_push_back (&ready_queues[t->priority], &t->elem);
+  ready_bitmap |= (uint64_t) 1 << t->priority;
+  ready_cnt++;
+}
+
+/* Removes ready thread T from its ready queue.  Interrupts must
+   be off. */
+static void
+ready_queue_remove (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  list_remove (&t->elem);
+  if (list_empty (&ready_queues[t->priority]))
+    ready_bitmap &= ~((uint64_t) 1 << t->priority);
+  ready_cnt--;
+}
+
+/* Removes and returns the thread at the front of the
+   highest-priority nonempty ready queue.  The ready queues must
+   not all be empty.  Interrupts must be off. */
+static struct thread *
+ready_queue_pop (void) 
+{
+  int priority = ready_max_priority ();
+  struct list *queue;
+  struct thread *t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (priority >= PRI_MIN);
+
+  queue = &ready_queues[priority];
+  t = list_entry (list_pop_front (queue), struct thread, elem);
+  if (list_empty (queue))
+    ready_bitmap &= ~((uint64_t) 1 << priority);
+  ready_cnt--;
+  return t;
+}
+
+/* Returns the priority of the highest-priority ready thread, or
+   -1 if no thread is ready.  Each half of the bitmap is
+   examined with a single bit-scan instruction. */
+static int
+ready_max_priority (void) 
+{
+  uint32_t high = ready_bitmap >> 32;
+  uint32_t low = ready_bitmap;
+
+  if (high != 0)
+    return 63 - __builtin_clz (high);
+  else if (low != 0)
+    return 31 - __builtin_clz (low);
+  else
+    return -1;
+}
+
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
@@ -591,10 +1103,10 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
+  if (ready_bitmap == 0)
     return idle_thread;
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    return ready_queue_pop ();
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -639,7 +1151,7 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      thread_page_put (prev);
     }
 }
 
@@ -664,35 +1176,26 @@ schedule (void)
   if (cur != next)
     prev = switch_threads (cur, next);
   thread_schedule_tail (prev);
+}
 
-    /* Unblocked elements which receieved SIG_UBLOCK signal. */
-    for (struct list_elem* elem = list_begin (&unblock_list); elem != list_end (&unblock_list);
-         elem = list_remove(elem))
-    {
-        struct thread* t = list_entry (elem, struct thread, unblock_elem);
-        thread_unblock (t);
-    }
+/* Returns a hash value for the tid of the thread that E is
+   embedded in. */
+static unsigned
+tid_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  const struct thread *t = hash_entry (e, struct thread, tid_elem);
+  return hash_int (t->tid);
+}
 
-    /* Process all signals in pending list. */
-    for (struct list_elem* tmp_elem = list_begin (&running_thread()->pending_signals);
-         tmp_elem != list_end (&running_thread()->pending_signals);
-         tmp_elem = list_remove(tmp_elem))
-    {
-        struct signal* s = list_entry (tmp_elem, struct signal, elem);
-
-        if (s->signum == SIG_CHLD)
-            CHLD_handler(s->sender);
-        else if (s->signum == SIG_USR)
-            USR_handler(s->sender);
-        else if (s->signum == SIG_KILL)
-            KILL_handler(s->sender);
-        else
-            continue;
-    }
+/* Returns true if thread A has a lower tid than thread B. */
+static bool
+tid_less (const struct hash_elem *a_, const struct hash_elem *b_,
+          void *aux UNUSED) 
+{
+  const struct thread *a = hash_entry (a_, struct thread, tid_elem);
+  const struct thread *b = hash_entry (b_, struct thread, tid_elem);
 
-    /* Process SIG_CPU is end of lifetime reached. */
-    if (running_thread()->is_life_over)
-        CPU_handler();
+  return a->tid < b->tid;
 }
 
 /* Returns a tid to use for a new thread. */
@@ -709,7 +1212,9 @@ allocate_tid (void)
   return tid;
 }
 
-/* Function to set lifetime of current thread. */
+/* Function to set lifetime of current thread, in timer ticks of
+   CPU time.  Only ticks during which the thread is running count
+   toward its lifetime. */
 void setlifetime(unsigned long long int lifetime)
 {
     thread_current()->thread_life_time = lifetime;
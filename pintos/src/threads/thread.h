@@ -2,8 +2,10 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
 #include <stdint.h>
+#include "threads/fixed-point.h"
 #include "threads/signal.h"
 
 /* States in a thread's life cycle. */
@@ -25,6 +27,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, for the multi-level feedback queue scheduler. */
+#define NICE_MIN -20                    /* Nicest. */
+#define NICE_DEFAULT 0                  /* Default. */
+#define NICE_MAX 20                     /* Least nice. */
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -75,12 +82,14 @@ typedef int tid_t;
    the `magic' member of the running thread's `struct thread' is
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/* The `elem' member has a triple purpose.  It can be an element
+   in the run queue (thread.c), an element in a semaphore wait
+   list (synch.c), or an element in the sleeping-thread wheel
+   (devices/timer.c).  It can be used these ways only because
+   they are mutually exclusive: only a thread in the ready state
+   is on the run queue, whereas only a blocked thread is on a
+   semaphore wait list or asleep in the timer wheel, and never
+   both at once. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -88,15 +97,51 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
+    int priority;                       /* Priority, including donations. */
+    int base_priority;                  /* Priority, excluding donations. */
     struct list_elem allelem;           /* List element for all threads list. */
+    struct hash_elem tid_elem;          /* Element in tid index. */
+
+    /* Shared between thread.c and synch.c, for priority donation. */
+    struct list held_locks;             /* Locks held, for donations. */
+    struct lock *waiting_lock;          /* Lock being waited on, if any. */
 
-    /* Shared between thread.c and synch.c. */
+    /* Shared between thread.c, synch.c and devices/timer.c. */
     struct list_elem elem;              /* List element. */
 
+    /* Owned by thread.c, for the multi-level feedback queue
+       scheduler.  recent_cpu is only brought up to date with the
+       per-second decay when the thread becomes ready again, so it
+       is stale while the thread is blocked. */
+    int nice;                           /* Niceness. */
+    fixed_point recent_cpu;             /* Recent CPU time received. */
+    int recent_cpu_epoch;               /* Second recent_cpu is current as of. */
+
+    /* Owned by devices/timer.c. */
+    int64_t wakeup_tick;                /* Tick to wake up at, 0 if awake. */
+
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+    struct exit_record *exit_record;    /* Shared with parent, if a process. */
+    struct hash *child_records;         /* Children's exit records, by tid. */
+    struct file *executable;            /* Running executable, write-denied. */
+    struct file **files;                /* Open files, indexed by fd. */
+    struct bitmap *fd_map;              /* Descriptors in use. */
+    size_t fd_cnt;                      /* Size of files and fd_map. */
+#endif
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct hash *pages;                 /* Supplemental page table. */
+    void *user_esp;                     /* User stack pointer on kernel entry. */
+
+    /* Owned by vm/mmap.c. */
+    struct list mappings;               /* Memory-mapped files. */
+    int next_mapping_id;                /* Id for the next mapping. */
+#endif
+#ifdef FILESYS
+    /* Owned by filesys/filesys.c. */
+    struct dir *cwd;                    /* Current directory, null for root. */
 #endif
 
     /* Owned by thread.c. */
@@ -107,19 +152,27 @@ struct thread
     struct list children_list;
     bool is_parent;
 
-    /* Fields to set process thread lifetime. */
+    /* Fields to set process thread lifetime.  thread_total_time
+       counts the ticks this thread has spent running, and SIG_CPU
+       is raised once it reaches thread_life_time (-1 if none). */
     long long int thread_life_time;
     long long int thread_total_time;
     bool is_life_over;
 
     struct list_elem child_elem;        /* Element in child list of parent. */
-    struct list_elem unblock_elem;      /* Element in unblock list for thread. */
+
+    /* Result of the last thread_is_ancestor() check on this
+       thread, valid while ancestor_cache_gen is current. */
+    tid_t ancestor_cache_tid;           /* Ancestor that was checked. */
+    bool ancestor_cache_result;         /* Whether it was an ancestor. */
+    unsigned ancestor_cache_gen;        /* Lineage generation of result. */
 
     /* Child process counters. */
     unsigned int total_children;
     unsigned int alive_children;
 
-    struct list pending_signals;        /* Pending signals list. */
+    unsigned short pending_signals;     /* Bitmap of pending signals. */
+    int signal_senders[SIG_CNT];        /* Last sender of each signal. */
     unsigned short sigmask;
   };
 
@@ -127,13 +180,13 @@ struct thread
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
-extern struct list unblock_list;
 
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+int64_t thread_idle_ticks (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -143,18 +196,21 @@ void thread_unblock (struct thread *);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
-struct thread* validated_tid (int tid);
+bool thread_is_ancestor (struct thread *ancestor, struct thread *);
 const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
 void thread_foreach (thread_action_func *, void *);
+bool thread_for_tid (tid_t, thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_update_priority (struct thread *);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
@@ -4,11 +4,15 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
-static void kill (struct intr_frame *);
+static void kill_process (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
@@ -33,25 +37,29 @@ exception_init (void)
      e.g. via the INT, INT3, INTO, and BOUND instructions.  Thus,
      we set DPL==3, meaning that user programs are allowed to
      invoke them via these instructions. */
-  intr_register_int (3, 3, INTR_ON, kill, "#BP Breakpoint Exception");
-  intr_register_int (4, 3, INTR_ON, kill, "#OF Overflow Exception");
-  intr_register_int (5, 3, INTR_ON, kill,
+  intr_register_int (3, 3, INTR_ON, kill_process, "#BP Breakpoint Exception");
+  intr_register_int (4, 3, INTR_ON, kill_process, "#OF Overflow Exception");
+  intr_register_int (5, 3, INTR_ON, kill_process,
                      "#BR BOUND Range Exceeded Exception");
 
   /* These exceptions have DPL==0, preventing user processes from
      invoking them via the INT instruction.  They can still be
      caused indirectly, e.g. #DE can be caused by dividing by
      0.  */
-  intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
-  intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
-  intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
-  intr_register_int (7, 0, INTR_ON, kill,
+  intr_register_int (0, 0, INTR_ON, kill_process, "#DE Divide Error");
+  intr_register_int (1, 0, INTR_ON, kill_process, "#DB Debug Exception");
+  intr_register_int (6, 0, INTR_ON, kill_process,
+                     "#UD Invalid Opcode Exception");
+  intr_register_int (7, 0, INTR_ON, kill_process,
                      "#NM Device Not Available Exception");
-  intr_register_int (11, 0, INTR_ON, kill, "#NP Segment Not Present");
-  intr_register_int (12, 0, INTR_ON, kill, "#SS Stack Fault Exception");
-  intr_register_int (13, 0, INTR_ON, kill, "#GP General Protection Exception");
-  intr_register_int (16, 0, INTR_ON, kill, "#MF x87 FPU Floating-Point Error");
-  intr_register_int (19, 0, INTR_ON, kill,
+  intr_register_int (11, 0, INTR_ON, kill_process, "#NP Segment Not Present");
+  intr_register_int (12, 0, INTR_ON, kill_process,
+                     "#SS Stack Fault Exception");
+  intr_register_int (13, 0, INTR_ON, kill_process,
+                     "#GP General Protection Exception");
+  intr_register_int (16, 0, INTR_ON, kill_process,
+                     "#MF x87 FPU Floating-Point Error");
+  intr_register_int (19, 0, INTR_ON, kill_process,
                      "#XF SIMD Floating-Point Exception");
 
   /* Most exceptions can be handled with interrupts turned on.
@@ -69,7 +77,7 @@ exception_print_stats (void)
 
 /* Handler for an exception (probably) caused by a user process. */
 static void
-kill (struct intr_frame *f) 
+kill_process (struct intr_frame *f) 
 {
   /* This interrupt is one (probably) caused by a user process.
      For example, the process might have tried to access unmapped
@@ -148,14 +156,41 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
-  /* To implement virtual memory, delete the rest of the function
-     body, and replace it with code that brings in the page to
-     which fault_addr refers. */
+#ifdef VM
+  /* Bring in pages that are part of the process's address space
+     but not yet in memory, whether the process touched them or
+     the kernel did on its behalf during a system call.  In the
+     latter case, the process's stack pointer is the one that
+     syscall_handler() saved. */
+  if (user)
+    thread_current ()->user_esp = f->esp;
+  if (not_present && page_in (fault_addr, write))
+    return;
+
+  /* A write to a present, read-only page of a writable segment
+     means the page's frame is shared with other processes
+     running the same program, and it needs a copy of its own. */
+  if (!not_present && write && page_copy_on_write (fault_addr))
+    return;
+#endif
+
+  /* A fault in the kernel at a user address can only come from
+     get_user() or put_user() in userprog/syscall.c, which put
+     the address to resume at in %eax and expect -1 back there. */
+  if (!user && is_user_vaddr (fault_addr))
+    {
+      f->eip = (void (*) (void)) f->eax;
+      f->eax = 0xffffffff;
+      return;
+    }
+
+  /* Any other fault is a bug: kill the process, or panic if the
+     fault came from the kernel. */
   printf ("Page fault at %p: %s error %s page in %s context.\n",
           fault_addr,
           not_present ? "not present" : "rights violation",
           write ? "writing" : "reading",
           user ? "user" : "kernel");
-  kill (f);
+  kill_process (f);
 }
 
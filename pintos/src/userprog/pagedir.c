@@ -6,8 +6,14 @@
 #include "threads/pte.h"
 #include "threads/palloc.h"
 
+/* Beyond this many pages, reloading CR3 to flush the whole TLB
+   is cheaper than invalidating each page with INVLPG. */
+#define INVLPG_MAX 32
+
 static uint32_t *active_pd (void);
+static void load_pd (uint32_t *);
 static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -152,10 +158,49 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
     }
 }
 
+/* Marks the PAGE_CNT user virtual pages starting at UPAGE "not
+   present" in page directory PD, as if by pagedir_clear_page()
+   on each of them, but invalidates the TLB only once at the
+   end: each page that was actually present is invalidated on
+   its own, unless there are more than INVLPG_MAX of them, in
+   which case the whole TLB is flushed. */
+void
+pagedir_clear_pages (uint32_t *pd, void *upage, size_t page_cnt)
+{
+  uint8_t *base = upage;
+  uint8_t *cleared[INVLPG_MAX];
+  size_t cleared_cnt = 0;
+  size_t i;
+
+  ASSERT (pg_ofs (upage) == 0);
+
+  for (i = 0; i < page_cnt; i++)
+    {
+      uint8_t *vpage = base + i * PGSIZE;
+      uint32_t *pte;
+
+      ASSERT (is_user_vaddr (vpage));
+      pte = lookup_page (pd, vpage, false);
+      if (pte != NULL && (*pte & PTE_P) != 0)
+        {
+          *pte &= ~PTE_P;
+          if (cleared_cnt < INVLPG_MAX)
+            cleared[cleared_cnt] = vpage;
+          cleared_cnt++;
+        }
+    }
+
+  if (cleared_cnt > INVLPG_MAX)
+    invalidate_pagedir (pd);
+  else
+    for (i = 0; i < cleared_cnt; i++)
+      invalidate_page (pd, cleared[i]);
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
    that is, if the page has been modified since the PTE was
    installed.
@@ -180,7 +225,7 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
@@ -209,19 +254,32 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
       else 
         {
           *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
 
 /* Loads page directory PD into the CPU's page directory base
-   register. */
+   register, unless it is already there.  A null PD stands for
+   the kernel-only page directory. */
 void
 pagedir_activate (uint32_t *pd) 
 {
   if (pd == NULL)
     pd = init_page_dir;
 
+  /* Loading CR3 flushes the TLB, which is wasted work if PD is
+     already active.  Every change to the active page directory
+     invalidates its own TLB entries, so they cannot be stale. */
+  if (active_pd () != pd)
+    load_pd (pd);
+}
+
+/* Loads page directory PD into the CPU's page directory base
+   register, flushing the TLB. */
+static void
+load_pd (uint32_t *pd) 
+{
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
@@ -256,8 +314,20 @@ invalidate_pagedir (uint32_t *pd)
 {
   if (active_pd () == pd) 
     {
-      /* Re-activating PD clears the TLB.  See [IA32-v3a] 3.12
+      /* Re-loading PD clears the TLB.  See [IA32-v3a] 3.12
          "Translation Lookaside Buffers (TLBs)". */
-      pagedir_activate (pd);
+      load_pd (pd);
     } 
 }
+
+/* Invalidates the TLB entry, if any, for virtual page VPAGE in
+   page directory PD, if PD is the active page directory.  This
+   is much cheaper than invalidate_pagedir(), which throws away
+   every other translation too.  See [IA32-v2a] "INVLPG--
+   Invalidate TLB Entry". */
+static void
+invalidate_page (uint32_t *pd, const void *vpage) 
+{
+  if (active_pd () == pd) 
+    asm volatile ("invlpg (%0)" : : "r" (vpage) : "memory");
+}
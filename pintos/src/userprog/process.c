@@ -1,5 +1,6 @@
 #include "userprog/process.h"
 #include <debug.h>
+#include <bitmap.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
@@ -7,6 +8,7 @@
 #include <string.h>
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -14,55 +16,164 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
+
+/* File descriptors.  See the comment above grow_fd_table(). */
+#define FD_FIRST 2              /* Lowest descriptor for a file. */
+#define FD_INITIAL_CNT 16       /* Initial size of descriptor table. */
+
+/* Passed from process_execute() to start_process(), on the
+   parent's stack. */
+struct start_info
+  {
+    char *file_name;                    /* Page holding the command line. */
+    struct exit_record *record;         /* New process's exit record. */
+    struct dir *cwd;                    /* Parent's current directory. */
+    struct semaphore loaded;            /* Upped once load has finished. */
+    bool success;                       /* Whether the load succeeded. */
+  };
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool load (char *cmd_line, void (**eip) (void), void **esp);
+static void release_exit_record (struct exit_record *);
+static hash_hash_func exit_record_hash;
+static hash_less_func exit_record_less;
 
 /* Starts a new thread running a user program loaded from
-   FILENAME.  The new thread may be scheduled (and may even exit)
-   before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+   FILENAME, and waits for it to finish loading.  FILENAME is a
+   command line: the program's name followed by its arguments,
+   separated by spaces.  The new thread may exit before
+   process_execute() returns.  Returns the new process's thread
+   id, or TID_ERROR if the thread cannot be created or the
+   program cannot be loaded. */
 tid_t
 process_execute (const char *file_name) 
 {
-  char *fn_copy;
+  struct thread *cur = thread_current ();
+  struct start_info info;
+  struct exit_record *record;
+  char name[16];
+  size_t name_len;
   tid_t tid;
 
   /* Make a copy of FILE_NAME.
-     Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
+     Otherwise there's a race between the caller and load().
+     A command line too long for the copy could not fit on the
+     new process's stack either. */
+  info.file_name = palloc_get_page (0);
+  if (info.file_name == NULL)
     return TID_ERROR;
-  strlcpy (fn_copy, file_name, PGSIZE);
+  if (strlcpy (info.file_name, file_name, PGSIZE) >= PGSIZE)
+    {
+      palloc_free_page (info.file_name);
+      return TID_ERROR;
+    }
+
+  /* Name the thread after the program alone, truncated as
+     thread_create() would. */
+  file_name += strspn (file_name, " ");
+  name_len = strcspn (file_name, " ");
+  strlcpy (name, file_name,
+           name_len < sizeof name ? name_len + 1 : sizeof name);
+
+  /* Our children's exit records are indexed by tid, so that
+     process_wait() can find one without a search. */
+  if (cur->child_records == NULL)
+    {
+      cur->child_records = malloc (sizeof *cur->child_records);
+      if (cur->child_records == NULL
+          || !hash_init (cur->child_records,
+                         exit_record_hash, exit_record_less, NULL))
+        {
+          free (cur->child_records);
+          cur->child_records = NULL;
+          palloc_free_page (info.file_name);
+          return TID_ERROR;
+        }
+    }
+
+  /* The exit record starts out held by both parent and child. */
+  record = malloc (sizeof *record);
+  if (record == NULL)
+    {
+      palloc_free_page (info.file_name);
+      return TID_ERROR;
+    }
+  record->tid = TID_ERROR;
+  record->status = -1;
+  sema_init (&record->exited, 0);
+  record->ref_cnt = 2;
+  info.record = record;
+  info.cwd = cur->cwd;
+  sema_init (&info.loaded, 0);
+  info.success = false;
 
   /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
+  tid = thread_create (name, PRI_DEFAULT, start_process, &info);
   if (tid == TID_ERROR)
-    palloc_free_page (fn_copy); 
+    {
+      palloc_free_page (info.file_name);
+      free (record);
+      return TID_ERROR;
+    }
+
+  /* INFO lives on our stack, so we must not return before the
+     child is done with it. */
+  sema_down (&info.loaded);
+  if (!info.success)
+    {
+      release_exit_record (record);
+      return TID_ERROR;
+    }
+  hash_insert (cur->child_records, &record->elem);
   return tid;
 }
 
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *info_)
 {
-  char *file_name = file_name_;
+  struct start_info *info = info_;
+  struct thread *cur = thread_current ();
+  char *file_name = info->file_name;
   struct intr_frame if_;
   bool success;
 
+  cur->exit_record = info->record;
+  cur->exit_record->tid = cur->tid;
+
+  /* Start out in our parent's current directory, which is also
+     where a relative FILE_NAME is found. */
+  success = true;
+  if (info->cwd != NULL)
+    {
+      lock_acquire (&filesys_lock);
+      cur->cwd = dir_reopen (info->cwd);
+      success = cur->cwd != NULL;
+      lock_release (&filesys_lock);
+    }
+
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  success = success && load (file_name, &if_.eip, &if_.esp);
 
-  /* If load failed, quit. */
+  /* Tell our parent how the load went.  After this, INFO may no
+     longer exist.  If load failed, quit. */
   palloc_free_page (file_name);
+  info->success = success;
+  sema_up (&info->loaded);
   if (!success) 
     thread_exit ();
 
@@ -83,12 +194,75 @@ start_process (void *file_name_)
    been successfully called for the given TID, returns -1
    immediately, without waiting.
 
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   The child's exit record is looked up by tid in the caller's
+   own hash of them, and the caller sleeps on the child's own
+   semaphore, so it is woken exactly once, when that child
+   exits. */
 int
-process_wait (tid_t child_tid UNUSED) 
+process_wait (tid_t child_tid) 
 {
-  return -1;
+  struct thread *cur = thread_current ();
+  struct exit_record key;
+  struct exit_record *r;
+  struct hash_elem *e;
+  int status;
+
+  if (cur->child_records == NULL)
+    return -1;
+  key.tid = child_tid;
+  e = hash_delete (cur->child_records, &key.elem);
+  if (e == NULL)
+    return -1;
+
+  r = hash_entry (e, struct exit_record, elem);
+  sema_down (&r->exited);
+  status = r->status;
+  release_exit_record (r);
+  return status;
+}
+
+/* Drops a reference to exit record R, freeing it if that was the
+   last one. */
+static void
+release_exit_record (struct exit_record *r)
+{
+  enum intr_level old_level;
+  bool last;
+
+  old_level = intr_disable ();
+  last = --r->ref_cnt == 0;
+  intr_set_level (old_level);
+
+  if (last)
+    free (r);
+}
+
+/* Returns a hash value for the tid of the exit record that E is
+   embedded in. */
+static unsigned
+exit_record_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct exit_record *r = hash_entry (e, struct exit_record, elem);
+  return hash_int (r->tid);
+}
+
+/* Returns true if the exit record that A is embedded in has a
+   lower tid than the one that B is embedded in. */
+static bool
+exit_record_less (const struct hash_elem *a_, const struct hash_elem *b_,
+                  void *aux UNUSED)
+{
+  const struct exit_record *a = hash_entry (a_, struct exit_record, elem);
+  const struct exit_record *b = hash_entry (b_, struct exit_record, elem);
+  return a->tid < b->tid;
+}
+
+/* Drops the parent's reference to the exit record that E is
+   embedded in. */
+static void
+destroy_exit_record (struct hash_elem *e, void *aux UNUSED)
+{
+  release_exit_record (hash_entry (e, struct exit_record, elem));
 }
 
 /* Free the current process's resources. */
@@ -98,6 +272,57 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
+  /* Close all of our open files. */
+  if (cur->files != NULL)
+    {
+      size_t fd;
+
+      lock_acquire (&filesys_lock);
+      for (fd = FD_FIRST; fd < cur->fd_cnt; fd++)
+        file_close (cur->files[fd]);
+      lock_release (&filesys_lock);
+      free (cur->files);
+      bitmap_destroy (cur->fd_map);
+      cur->files = NULL;
+      cur->fd_map = NULL;
+      cur->fd_cnt = 0;
+    }
+
+  /* Leave our current directory. */
+  if (cur->cwd != NULL)
+    {
+      lock_acquire (&filesys_lock);
+      dir_close (cur->cwd);
+      lock_release (&filesys_lock);
+      cur->cwd = NULL;
+    }
+
+#ifdef VM
+  /* Write back and remove our memory mappings, then the rest of
+     our pages, which may still refer to the executable, so they
+     must go before it is closed. */
+  mmap_exit ();
+  page_exit ();
+#endif
+
+  /* Allow writes to our executable again. */
+  if (cur->executable != NULL)
+    {
+      lock_acquire (&filesys_lock);
+      file_close (cur->executable);
+      lock_release (&filesys_lock);
+      cur->executable = NULL;
+    }
+
+  /* Let go of our children's exit records.  Those of children
+     that are still running are freed when they exit. */
+  if (cur->child_records != NULL)
+    {
+      hash_destroy (cur->child_records, destroy_exit_record);
+      free (cur->child_records);
+      cur->child_records = NULL;
+    }
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -114,6 +339,117 @@ process_exit (void)
       pagedir_activate (NULL);
       pagedir_destroy (pd);
     }
+
+  /* Report our exit status to our parent, which may be waiting
+     for it.  This comes last, so that by the time the parent
+     wakes up our mappings have been written back and our
+     executable may be written again. */
+  if (cur->exit_record != NULL)
+    {
+      printf ("%s: exit(%d)\n", cur->name, cur->exit_record->status);
+      sema_up (&cur->exit_record->exited);
+      release_exit_record (cur->exit_record);
+      cur->exit_record = NULL;
+    }
+}
+
+/* File descriptors.
+
+   Each process keeps its open files in an array indexed by file
+   descriptor, so looking one up takes constant time, along with
+   a bitmap of the descriptors in use.  bitmap_scan() finds the
+   lowest free descriptor by skipping full words of the bitmap
+   and then using a single bit scan within the first word with a
+   free bit.  Both double in size when every descriptor is taken.
+   Descriptors 0 and 1 are the console's and never refer to a
+   file. */
+
+/* Doubles the size of the current process's descriptor table,
+   creating it if it does not exist.  Returns true if successful,
+   false if memory is exhausted. */
+static bool
+grow_fd_table (void)
+{
+  struct thread *cur = thread_current ();
+  size_t old_cnt = cur->fd_cnt;
+  size_t new_cnt = old_cnt == 0 ? FD_INITIAL_CNT : old_cnt * 2;
+  struct file **files;
+  struct bitmap *fd_map;
+
+  fd_map = bitmap_create (new_cnt);
+  if (fd_map == NULL)
+    return false;
+  files = realloc (cur->files, new_cnt * sizeof *files);
+  if (files == NULL)
+    {
+      bitmap_destroy (fd_map);
+      return false;
+    }
+
+  /* The table only grows when it is full, so every old
+     descriptor is in use, as are the console's. */
+  memset (files + old_cnt, 0, (new_cnt - old_cnt) * sizeof *files);
+  bitmap_set_multiple (fd_map, 0, old_cnt > FD_FIRST ? old_cnt : FD_FIRST,
+                       true);
+  if (cur->fd_map != NULL)
+    bitmap_destroy (cur->fd_map);
+  cur->files = files;
+  cur->fd_map = fd_map;
+  cur->fd_cnt = new_cnt;
+  return true;
+}
+
+/* Gives FILE the lowest free descriptor in the current process
+   and returns it, or -1 if memory is exhausted. */
+int
+process_add_file (struct file *file)
+{
+  struct thread *cur = thread_current ();
+  size_t fd;
+
+  ASSERT (file != NULL);
+
+  fd = cur->fd_map != NULL
+       ? bitmap_scan_and_flip (cur->fd_map, 0, 1, false)
+       : BITMAP_ERROR;
+  if (fd == BITMAP_ERROR)
+    {
+      fd = cur->fd_cnt > FD_FIRST ? cur->fd_cnt : FD_FIRST;
+      if (!grow_fd_table ())
+        return -1;
+      bitmap_mark (cur->fd_map, fd);
+    }
+  cur->files[fd] = file;
+  return fd;
+}
+
+/* Returns the file open as FD in the current process, or a null
+   pointer if FD is not open. */
+struct file *
+process_get_file (int fd)
+{
+  struct thread *cur = thread_current ();
+
+  if (fd < FD_FIRST || (size_t) fd >= cur->fd_cnt)
+    return NULL;
+  return cur->files[fd];
+}
+
+/* Frees descriptor FD in the current process and returns the
+   file it referred to, which the caller must close, or a null
+   pointer if FD was not open. */
+struct file *
+process_remove_file (int fd)
+{
+  struct thread *cur = thread_current ();
+  struct file *file = process_get_file (fd);
+
+  if (file != NULL)
+    {
+      cur->files[fd] = NULL;
+      bitmap_reset (cur->fd_map, fd);
+    }
+  return file;
 }
 
 /* Sets up the CPU for running user code in the current
@@ -124,8 +460,14 @@ process_activate (void)
 {
   struct thread *t = thread_current ();
 
-  /* Activate thread's page tables. */
-  pagedir_activate (t->pagedir);
+  /* Activate thread's page tables.  A kernel thread touches only
+     kernel memory, which every page directory maps the same way,
+     so it keeps whatever page directory is active instead of
+     flushing the TLB to load the kernel-only one.  (A process
+     always activates the kernel-only page directory before it
+     destroys its own, so the active one is never freed.) */
+  if (t->pagedir != NULL)
+    pagedir_activate (t->pagedir);
 
   /* Set thread's kernel stack for use in processing
      interrupts. */
@@ -196,32 +538,49 @@ struct Elf32_Phdr
 #define PF_R 4          /* Readable. */
 
 static bool setup_stack (void **esp);
+static bool setup_args (const char *file_name, char **save_ptr, void **esp);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
-   Stores the executable's entry point into *EIP
-   and its initial stack pointer into *ESP.
+/* Loads an ELF executable into the current thread, running
+   the command line CMD_LINE, which is modified: the first word of
+   CMD_LINE names the executable, and all the words become its
+   arguments.  Stores the executable's entry point into *EIP and
+   its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
 bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+load (char *cmd_line, void (**eip) (void), void **esp) 
 {
   struct thread *t = thread_current ();
   struct Elf32_Ehdr ehdr;
   struct file *file = NULL;
+  char *file_name, *save_ptr;
   off_t file_ofs;
   bool success = false;
   int i;
 
+  lock_acquire (&filesys_lock);
+
+  /* The command line is split into words just once, as its
+     arguments are copied onto the stack, starting here. */
+  file_name = strtok_r (cmd_line, " ", &save_ptr);
+  if (file_name == NULL)
+    goto done;
+
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
     goto done;
   process_activate ();
+#ifdef VM
+  if (!page_init ())
+    goto done;
+#endif
 
-  /* Open executable file. */
+  /* Open executable file.  It stays open, and unwritable, for
+     as long as the process runs. */
   file = filesys_open (file_name);
   if (file == NULL) 
     {
@@ -312,13 +671,28 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
  done:
   /* We arrive here whether the load is successful or not. */
-  file_close (file);
+  if (success)
+    {
+      file_deny_write (file);
+      t->executable = file;
+    }
+  else
+    file_close (file);
+  lock_release (&filesys_lock);
+
+  /* Only now pass the arguments, because with virtual memory,
+     bringing in the stack page may evict another process's page
+     and write it back to its file, which needs filesys_lock. */
+  if (success)
+    success = setup_args (file_name, &save_ptr, esp);
   return success;
 }
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -377,6 +751,10 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   With virtual memory, the pages are only entered into the
+   supplemental page table here, and are initialized as described
+   above when the process first touches them.
+
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
@@ -396,6 +774,20 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+      /* Just record where the page comes from.  It is read in
+         by page_in() when the process first touches it. */
+      struct page *p = page_allocate (upage, !writable);
+      if (p == NULL)
+        return false;
+      if (page_read_bytes > 0)
+        {
+          p->file = file;
+          p->file_offset = ofs;
+          p->file_bytes = page_read_bytes;
+        }
+      ofs += page_read_bytes;
+#else
       /* Get a page of memory. */
       uint8_t *kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
@@ -415,6 +807,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
           palloc_free_page (kpage);
           return false; 
         }
+#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
@@ -429,6 +822,13 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 static bool
 setup_stack (void **esp) 
 {
+#ifdef VM
+  /* The page is zero-filled when it is first touched. */
+  if (page_allocate (((uint8_t *) PHYS_BASE) - PGSIZE, false) == NULL)
+    return false;
+  *esp = PHYS_BASE;
+  return true;
+#else
   uint8_t *kpage;
   bool success = false;
 
@@ -442,8 +842,88 @@ setup_stack (void **esp)
         palloc_free_page (kpage);
     }
   return success;
+#endif
+}
+
+/* Copies the program's arguments onto the stack set up by
+   setup_stack(), with *ESP at its top, and adjusts *ESP to point
+   to the word below them, the return address of the call to
+   main(int argc, char *argv[]) in the program's _start().
+   FILE_NAME is the first argument; the others are the rest of
+   the words that strtok_r() will return for SAVE_PTR.
+
+   The words are copied as they are split off the command line,
+   each below the one before, so that argv[] must be filled in
+   from the last word to the first.  Below the words come padding
+   to a word boundary, argv[] with a null pointer at argv[argc],
+   then argv, argc, and a null return address.  Fails, leaving
+   the stack in an unspecified state, if all of that does not fit
+   in the stack's single page.  Returns true if successful, false
+   otherwise. */
+static bool
+setup_args (const char *file_name, char **save_ptr, void **esp) 
+{
+  uint8_t *upage = (uint8_t *) PHYS_BASE - PGSIZE;
+  uint8_t *kpage;
+  const char *arg;
+  size_t ofs, strings;
+  char **argv;
+  int argc, i;
+
+  ASSERT (*esp == PHYS_BASE);
+
+#ifdef VM
+  if (!page_lock (upage, true))
+    return false;
+#endif
+  kpage = pagedir_get_page (thread_current ()->pagedir, upage);
+
+  ofs = PGSIZE;
+  argc = 0;
+  for (arg = file_name; arg != NULL; arg = strtok_r (NULL, " ", save_ptr))
+    {
+      size_t size = strlen (arg) + 1;
+
+      /* Leave room below for padding and for ARGC + 2 pointers
+         in argv[], plus argv, argc, and the return address. */
+      if (size + (argc + 5) * sizeof (char *) + 3 > ofs)
+        goto fail;
+      ofs -= size;
+      memcpy (kpage + ofs, arg, size);
+      argc++;
+    }
+  strings = ofs;
+
+  ofs = ROUND_DOWN (ofs, sizeof (char *)) - (argc + 1) * sizeof (char *);
+  argv = (char **) (kpage + ofs);
+  argv[argc] = NULL;
+  for (i = argc - 1; i >= 0; i--)
+    {
+      argv[i] = (char *) upage + strings;
+      strings += strlen ((char *) kpage + strings) + 1;
+    }
+
+  ofs -= sizeof (char **);
+  *(char ***) (kpage + ofs) = (char **) (upage + ofs + sizeof (char **));
+  ofs -= sizeof (int);
+  *(int *) (kpage + ofs) = argc;
+  ofs -= sizeof (void *);
+  *(void **) (kpage + ofs) = NULL;
+  *esp = upage + ofs;
+
+#ifdef VM
+  page_unlock (upage);
+#endif
+  return true;
+
+ fail:
+#ifdef VM
+  page_unlock (upage);
+#endif
+  return false;
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -463,3 +943,4 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
@@ -1,11 +1,32 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <hash.h>
+#include "threads/synch.h"
 #include "threads/thread.h"
 
+/* A child process's exit record, shared between the child and
+   its parent.  The child fills in STATUS and ups EXITED when it
+   exits; the parent downs EXITED in process_wait() to collect
+   it.  The record is freed by whichever of the two lets go of it
+   last, so the status of an exited child survives until its
+   parent reaps it or exits itself. */
+struct exit_record
+  {
+    tid_t tid;                          /* Child's thread identifier. */
+    int status;                         /* Exit status, -1 if killed. */
+    struct semaphore exited;            /* Upped when the child exits. */
+    int ref_cnt;                        /* Parent and/or child, 0 to 2. */
+    struct hash_elem elem;              /* Element in parent's hash. */
+  };
+
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
 
+int process_add_file (struct file *);
+struct file *process_get_file (int fd);
+struct file *process_remove_file (int fd);
+
 #endif /* userprog/process.h */
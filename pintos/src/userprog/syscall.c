@@ -1,20 +1,655 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include "userprog/process.h"
+#include "devices/input.h"
+#include "devices/shutdown.h"
+#include "filesys/directory.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/mmap.h"
+#include "vm/page.h"
+#endif
+
+/* A system call handler.  ARGS points to the call's arguments,
+   copied in from the user stack one 32-bit word apiece, which
+   the handler converts to their actual types itself. */
+typedef int syscall_function (const int *args);
+
+/* A system call. */
+struct syscall
+  {
+    size_t arg_cnt;             /* Number of arguments. */
+    syscall_function *func;     /* Implementation. */
+  };
+
+static syscall_function sys_halt;
+static syscall_function sys_exit;
+static syscall_function sys_exec;
+static syscall_function sys_wait;
+static syscall_function sys_create;
+static syscall_function sys_remove;
+static syscall_function sys_open;
+static syscall_function sys_filesize;
+static syscall_function sys_read;
+static syscall_function sys_write;
+static syscall_function sys_seek;
+static syscall_function sys_tell;
+static syscall_function sys_close;
+#ifdef VM
+static syscall_function sys_mmap;
+static syscall_function sys_munmap;
+#endif
+static syscall_function sys_chdir;
+static syscall_function sys_mkdir;
+static syscall_function sys_readdir;
+static syscall_function sys_isdir;
+static syscall_function sys_inumber;
+
+/* Table of system calls, indexed by number from syscall-nr.h.
+   Numbers without an entry are not supported yet, and a process
+   that uses one is terminated, as for any other bad number. */
+static const struct syscall syscall_table[] =
+  {
+    [SYS_HALT] = {0, sys_halt},
+    [SYS_EXIT] = {1, sys_exit},
+    [SYS_EXEC] = {1, sys_exec},
+    [SYS_WAIT] = {1, sys_wait},
+    [SYS_CREATE] = {2, sys_create},
+    [SYS_REMOVE] = {1, sys_remove},
+    [SYS_OPEN] = {1, sys_open},
+    [SYS_FILESIZE] = {1, sys_filesize},
+    [SYS_READ] = {3, sys_read},
+    [SYS_WRITE] = {3, sys_write},
+    [SYS_SEEK] = {2, sys_seek},
+    [SYS_TELL] = {1, sys_tell},
+    [SYS_CLOSE] = {1, sys_close},
+#ifdef VM
+    [SYS_MMAP] = {2, sys_mmap},
+    [SYS_MUNMAP] = {1, sys_munmap},
+#endif
+    [SYS_CHDIR] = {1, sys_chdir},
+    [SYS_MKDIR] = {1, sys_mkdir},
+    [SYS_READDIR] = {2, sys_readdir},
+    [SYS_ISDIR] = {1, sys_isdir},
+    [SYS_INUMBER] = {1, sys_inumber},
+  };
+
+#define SYSCALL_CNT (sizeof syscall_table / sizeof *syscall_table)
+
+/* Serializes calls into the file system, which does no locking
+   of its own. */
+struct lock filesys_lock;
 
 static void syscall_handler (struct intr_frame *);
+static void copy_in (void *, const void *, size_t);
+static void copy_out (void *, const void *, size_t);
+static char *copy_in_string (const char *);
+static void lock_user_page (void *, bool will_write);
+static void unlock_user_page (void *);
+static struct file *lookup_file (int handle);
+static void terminate (void) NO_RETURN;
 
 void
-syscall_init (void) 
+syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  lock_init (&filesys_lock);
+}
+
+/* System call handler.  The system call number and its
+   arguments are words on the user stack, which are copied in
+   with a single bounds check rather than by translating each
+   address through the page directory. */
+static void
+syscall_handler (struct intr_frame *f)
+{
+  const struct syscall *sc;
+  unsigned number;
+  int args[3];
+
+#ifdef VM
+  /* Page faults in the kernel need the user stack pointer to
+     tell whether the stack should grow. */
+  thread_current ()->user_esp = f->esp;
+#endif
+
+  copy_in (&number, f->esp, sizeof number);
+  if (number >= SYSCALL_CNT || syscall_table[number].func == NULL)
+    terminate ();
+  sc = syscall_table + number;
+
+  ASSERT (sc->arg_cnt <= sizeof args / sizeof *args);
+  memset (args, 0, sizeof args);
+  copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * sc->arg_cnt);
+
+  f->eax = sc->func (args);
+}
+
+/* Reads a byte at user virtual address UADDR, which must be
+   below PHYS_BASE.  Returns the byte value if successful, -1 if
+   a segfault occurred.
+
+   The address of the instruction after the access is loaded
+   into %eax beforehand.  If the access faults, page_fault()
+   sets %eip from %eax and stores -1 in %eax, so execution
+   resumes after the access with the failure reported in the
+   result. */
+static inline int
+get_user (const uint8_t *uaddr)
+{
+  int result;
+  asm ("movl $1f, %0; movzbl %1, %0; 1:"
+       : "=&a" (result) : "m" (*uaddr));
+  return result;
+}
+
+/* Writes BYTE to user address UDST, which must be below
+   PHYS_BASE.  Returns true if successful, false if a segfault
+   occurred.  Works the same way as get_user(). */
+static inline bool
+put_user (uint8_t *udst, uint8_t byte)
+{
+  int error_code;
+  asm ("movl $1f, %0; movb %b2, %1; 1:"
+       : "=&a" (error_code), "=m" (*udst) : "q" (byte));
+  return error_code != -1;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Terminates the process if any of the user bytes is
+   invalid. */
+static void
+copy_in (void *dst_, const void *usrc_, size_t size)
+{
+  uint8_t *dst = dst_;
+  const uint8_t *usrc = usrc_;
+
+  if (usrc + size < usrc || usrc + size > (uint8_t *) PHYS_BASE)
+    terminate ();
+  for (; size > 0; size--)
+    {
+      int byte = get_user (usrc++);
+      if (byte == -1)
+        terminate ();
+      *dst++ = byte;
+    }
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Terminates the process if any of the user bytes is
+   invalid. */
+static void
+copy_out (void *udst_, const void *src_, size_t size)
+{
+  uint8_t *udst = udst_;
+  const uint8_t *src = src_;
+
+  if (udst + size < udst || udst + size > (uint8_t *) PHYS_BASE)
+    terminate ();
+  for (; size > 0; size--)
+    if (!put_user (udst++, *src++))
+      terminate ();
+}
+
+/* Creates a copy of the null-terminated user string US in
+   kernel memory and returns it as a page that must be freed
+   with palloc_free_page().  Truncates the string at PGSIZE
+   bytes.  Terminates the process if any of the user bytes is
+   invalid, or if no memory is available. */
+static char *
+copy_in_string (const char *us)
+{
+  char *ks;
+  size_t length;
+
+  ks = palloc_get_page (0);
+  if (ks == NULL)
+    terminate ();
+
+  for (length = 0; length < PGSIZE; length++)
+    {
+      int byte;
+
+      if (!is_user_vaddr (us + length)
+          || (byte = get_user ((const uint8_t *) us + length)) == -1)
+        {
+          palloc_free_page (ks);
+          terminate ();
+        }
+      ks[length] = byte;
+      if (byte == '\0')
+        return ks;
+    }
+  ks[PGSIZE - 1] = '\0';
+  return ks;
+}
+
+/* Makes sure that the user page containing UADDR can be
+   accessed by the kernel, for writing as well if WILL_WRITE is
+   true, until unlock_user_page() is called.  With virtual
+   memory, this brings the page in and locks it into its frame,
+   so that it cannot be evicted, and so the kernel never faults
+   on it while holding filesys_lock.  Terminates the process if
+   the page is not valid. */
+static void
+lock_user_page (void *uaddr, bool will_write)
+{
+  if (!is_user_vaddr (uaddr))
+    terminate ();
+#ifdef VM
+  if (!page_lock (uaddr, will_write))
+    terminate ();
+#else
+  {
+    int byte = get_user (uaddr);
+    if (byte == -1 || (will_write && !put_user (uaddr, byte)))
+      terminate ();
+  }
+#endif
+}
+
+/* Undoes lock_user_page() for the page containing UADDR. */
+static void
+unlock_user_page (void *uaddr UNUSED)
+{
+#ifdef VM
+  page_unlock (uaddr);
+#endif
+}
+
+/* Halt system call. */
+static int
+sys_halt (const int *args UNUSED)
+{
+  shutdown_power_off ();
+}
+
+/* Exit system call. */
+static int
+sys_exit (const int *args)
+{
+  int status = args[0];
+  thread_current ()->exit_record->status = status;
+  thread_exit ();
+  NOT_REACHED ();
+}
+
+/* Exec system call. */
+static int
+sys_exec (const int *args)
+{
+  const char *ufile = (const char *) args[0];
+  tid_t tid;
+  char *kfile = copy_in_string (ufile);
+
+  tid = process_execute (kfile);
+  palloc_free_page (kfile);
+  return tid;
+}
+
+/* Wait system call. */
+static int
+sys_wait (const int *args)
+{
+  tid_t child = args[0];
+  return process_wait (child);
+}
+
+/* Create system call. */
+static int
+sys_create (const int *args)
+{
+  const char *ufile = (const char *) args[0];
+  unsigned initial_size = args[1];
+  char *kfile = copy_in_string (ufile);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  ok = filesys_create (kfile, initial_size);
+  lock_release (&filesys_lock);
+
+  palloc_free_page (kfile);
+  return ok;
+}
+
+/* Remove system call. */
+static int
+sys_remove (const int *args)
+{
+  const char *ufile = (const char *) args[0];
+  char *kfile = copy_in_string (ufile);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  ok = filesys_remove (kfile);
+  lock_release (&filesys_lock);
+
+  palloc_free_page (kfile);
+  return ok;
+}
+
+/* Open system call. */
+static int
+sys_open (const int *args)
+{
+  const char *ufile = (const char *) args[0];
+  char *kfile = copy_in_string (ufile);
+  struct file *file;
+  int handle = -1;
+
+  lock_acquire (&filesys_lock);
+  file = filesys_open (kfile);
+  if (file != NULL)
+    {
+      handle = process_add_file (file);
+      if (handle == -1)
+        file_close (file);
+    }
+  lock_release (&filesys_lock);
+
+  palloc_free_page (kfile);
+  return handle;
+}
+
+/* Filesize system call. */
+static int
+sys_filesize (const int *args)
+{
+  int handle = args[0];
+  struct file *file = lookup_file (handle);
+  int size;
+
+  lock_acquire (&filesys_lock);
+  size = file_length (file);
+  lock_release (&filesys_lock);
+
+  return size;
+}
+
+/* Read system call.  The data is read directly into the user
+   buffer, one page at a time. */
+static int
+sys_read (const int *args)
+{
+  int handle = args[0];
+  uint8_t *udst = (uint8_t *) args[1];
+  unsigned size = args[2];
+  struct file *file = NULL;
+  int bytes_read = 0;
+
+  if (handle != STDIN_FILENO)
+    {
+      file = lookup_file (handle);
+      if (inode_is_dir (file_get_inode (file)))
+        return -1;
+    }
+
+  while (size > 0)
+    {
+      size_t page_left = PGSIZE - pg_ofs (udst);
+      size_t chunk = size < page_left ? size : page_left;
+      off_t retval;
+
+      lock_user_page (udst, true);
+      if (file == NULL)
+        {
+          /* Keyboard read. */
+          size_t i;
+
+          for (i = 0; i < chunk; i++)
+            udst[i] = input_getc ();
+          retval = chunk;
+        }
+      else
+        {
+          lock_acquire (&filesys_lock);
+          retval = file_read (file, udst, chunk);
+          lock_release (&filesys_lock);
+        }
+      unlock_user_page (udst);
+
+      if (retval < 0)
+        {
+          if (bytes_read == 0)
+            bytes_read = -1;
+          break;
+        }
+      bytes_read += retval;
+      if (retval != (off_t) chunk)
+        break;
+
+      udst += chunk;
+      size -= chunk;
+    }
+  return bytes_read;
+}
+
+/* Write system call.  The data is written directly from the
+   user buffer, one page at a time. */
+static int
+sys_write (const int *args)
+{
+  int handle = args[0];
+  uint8_t *usrc = (uint8_t *) args[1];
+  unsigned size = args[2];
+  struct file *file = NULL;
+  int bytes_written = 0;
+
+  if (handle != STDOUT_FILENO)
+    {
+      file = lookup_file (handle);
+      if (inode_is_dir (file_get_inode (file)))
+        return -1;
+    }
+
+  while (size > 0)
+    {
+      size_t page_left = PGSIZE - pg_ofs (usrc);
+      size_t chunk = size < page_left ? size : page_left;
+      off_t retval;
+
+      lock_user_page (usrc, false);
+      if (file == NULL)
+        {
+          /* Console write. */
+          putbuf ((char *) usrc, chunk);
+          retval = chunk;
+        }
+      else
+        {
+          lock_acquire (&filesys_lock);
+          retval = file_write (file, usrc, chunk);
+          lock_release (&filesys_lock);
+        }
+      unlock_user_page (usrc);
+
+      if (retval < 0)
+        {
+          if (bytes_written == 0)
+            bytes_written = -1;
+          break;
+        }
+      bytes_written += retval;
+      if (retval != (off_t) chunk)
+        break;
+
+      usrc += chunk;
+      size -= chunk;
+    }
+  return bytes_written;
+}
+
+/* Seek system call. */
+static int
+sys_seek (const int *args)
+{
+  int handle = args[0];
+  unsigned position = args[1];
+  struct file *file = lookup_file (handle);
+
+  lock_acquire (&filesys_lock);
+  if ((off_t) position >= 0)
+    file_seek (file, position);
+  lock_release (&filesys_lock);
+
+  return 0;
+}
+
+/* Tell system call. */
+static int
+sys_tell (const int *args)
+{
+  int handle = args[0];
+  struct file *file = lookup_file (handle);
+  unsigned position;
+
+  lock_acquire (&filesys_lock);
+  position = file_tell (file);
+  lock_release (&filesys_lock);
+
+  return position;
+}
+
+/* Close system call. */
+static int
+sys_close (const int *args)
+{
+  int handle = args[0];
+  struct file *file = process_remove_file (handle);
+
+  if (file == NULL)
+    terminate ();
+  lock_acquire (&filesys_lock);
+  file_close (file);
+  lock_release (&filesys_lock);
+  return 0;
+}
+
+#ifdef VM
+/* Mmap system call. */
+static int
+sys_mmap (const int *args)
+{
+  int handle = args[0];
+  void *addr = (void *) args[1];
+  struct file *file = process_get_file (handle);
+
+  return file != NULL ? mmap_map (file, addr) : -1;
+}
+
+/* Munmap system call. */
+static int
+sys_munmap (const int *args)
+{
+  int mapping = args[0];
+  if (!mmap_unmap (mapping))
+    terminate ();
+  return 0;
+}
+#endif
+
+/* Chdir system call. */
+static int
+sys_chdir (const int *args)
+{
+  const char *udir = (const char *) args[0];
+  char *kdir = copy_in_string (udir);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  ok = filesys_chdir (kdir);
+  lock_release (&filesys_lock);
+
+  palloc_free_page (kdir);
+  return ok;
+}
+
+/* Mkdir system call. */
+static int
+sys_mkdir (const int *args)
+{
+  const char *udir = (const char *) args[0];
+  char *kdir = copy_in_string (udir);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  ok = filesys_mkdir (kdir);
+  lock_release (&filesys_lock);
+
+  palloc_free_page (kdir);
+  return ok;
+}
+
+/* Readdir system call.  HANDLE's file position is the position
+   within the directory. */
+static int
+sys_readdir (const int *args)
+{
+  int handle = args[0];
+  char *uname = (char *) args[1];
+  struct file *file = lookup_file (handle);
+  char name[NAME_MAX + 1];
+  struct dir *dir;
+  bool ok = false;
+
+  lock_acquire (&filesys_lock);
+  dir = dir_open (inode_reopen (file_get_inode (file)));
+  if (dir != NULL)
+    {
+      dir_seek (dir, file_tell (file));
+      ok = dir_readdir (dir, name);
+      file_seek (file, dir_tell (dir));
+      dir_close (dir);
+    }
+  lock_release (&filesys_lock);
+
+  if (ok)
+    copy_out (uname, name, strlen (name) + 1);
+  return ok;
+}
+
+/* Isdir system call. */
+static int
+sys_isdir (const int *args)
+{
+  int handle = args[0];
+  return inode_is_dir (file_get_inode (lookup_file (handle)));
+}
+
+/* Inumber system call. */
+static int
+sys_inumber (const int *args)
+{
+  int handle = args[0];
+  return inode_get_inumber (file_get_inode (lookup_file (handle)));
+}
+
+/* Returns the file that the current process has open as
+   HANDLE.  Terminates the process if HANDLE is not an open file
+   descriptor. */
+static struct file *
+lookup_file (int handle)
+{
+  struct file *file = process_get_file (handle);
+
+  if (file == NULL)
+    terminate ();
+  return file;
 }
 
+/* Terminates the current process with exit status -1, as for a
+   bad system call. */
 static void
-syscall_handler (struct intr_frame *f UNUSED) 
+terminate (void)
 {
-  printf ("system call!\n");
   thread_exit ();
 }
@@ -1,6 +1,11 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include "threads/synch.h"
+
+/* Held around every call into the file system. */
+extern struct lock filesys_lock;
+
 void syscall_init (void);
 
 #endif /* userprog/syscall.h */
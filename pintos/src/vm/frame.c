@@ -0,0 +1,445 @@
+#include "vm/frame.h"
+#include <stdio.h>
+#include <string.h>
+#include "vm/page.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Every page of the user pool, taken from palloc at startup. */
+static struct frame *frames;
+static size_t frame_cnt;
+
+/* Frames that hold no page, so that allocation does not have to
+   search for them. */
+static struct list free_frames;
+
+/* Shared frames, keyed by inode and range. */
+static struct hash shared_frames;
+
+/* Protects frame allocation: the free list, the clock hand, the
+   shared frame table, and the `pages' member of unlocked
+   frames. */
+static struct lock scan_lock;
+
+/* Signaled, with scan_lock held, whenever a frame is unlocked,
+   for allocations that found every frame locked. */
+static struct condition frame_unlocked;
+
+/* Clock hand: the next frame to consider for eviction. */
+static size_t hand;
+
+/* Number of pages evicted, and number of times a page was
+   mapped to an existing shared frame instead of a new one. */
+static long long evict_cnt;
+static long long share_cnt;
+
+static hash_hash_func share_hash;
+static hash_less_func share_less;
+
+/* Takes every page in the user pool into the frame table. */
+void
+frame_init (void)
+{
+  void *base;
+
+  lock_init (&scan_lock);
+  cond_init (&frame_unlocked);
+  list_init (&free_frames);
+  hash_init (&shared_frames, share_hash, share_less, NULL);
+
+  frames = malloc (sizeof *frames * palloc_free_cnt (PAL_USER));
+  if (frames == NULL)
+    PANIC ("out of memory allocating page frames");
+
+  while ((base = palloc_get_page (PAL_USER)) != NULL)
+    {
+      struct frame *f = &frames[frame_cnt++];
+      lock_init (&f->lock);
+      f->base = base;
+      list_init (&f->pages);
+      f->page_cnt = 0;
+      f->shared = false;
+      list_push_back (&free_frames, &f->free_elem);
+    }
+}
+
+/* Prints frame table statistics. */
+void
+frame_print_stats (void)
+{
+  printf ("Frames: %zu user frames, %lld evictions, %lld shared mappings\n",
+          frame_cnt, evict_cnt, share_cnt);
+}
+
+/* Adds page P to frame F, which must be locked. */
+static void
+attach_page (struct frame *f, struct page *p)
+{
+  list_push_back (&f->pages, &p->frame_elem);
+  f->page_cnt++;
+  p->frame = f;
+}
+
+/* Removes frame F from the shared frame table, if it is there.
+   scan_lock must be held. */
+static void
+unpublish (struct frame *f)
+{
+  if (f->shared)
+    {
+      hash_delete (&shared_frames, &f->share_elem);
+      f->shared = false;
+    }
+}
+
+/* Takes a frame off the free list, locks it, and gives it to
+   page P.  Returns the frame, or a null pointer if none is free.
+   scan_lock must be held. */
+static struct frame *
+alloc_free_frame (struct page *p)
+{
+  struct frame *f;
+
+  if (list_empty (&free_frames))
+    return NULL;
+  f = list_entry (list_pop_front (&free_frames), struct frame, free_elem);
+  lock_acquire (&f->lock);
+  attach_page (f, p);
+  return f;
+}
+
+/* Returns true if any page in frame F, which must be locked, has
+   been accessed since the last call, clearing all of their
+   accessed bits. */
+static bool
+accessed_recently (struct frame *f)
+{
+  struct list_elem *e;
+  bool accessed = false;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    if (page_accessed_recently (list_entry (e, struct page, frame_elem)))
+      accessed = true;
+  return accessed;
+}
+
+/* Evicts every page in frame F, which must be locked.  Returns
+   true if successful, false if a page could not be written out,
+   in which case F is unchanged. */
+static bool
+evict_pages (struct frame *f)
+{
+  struct list_elem *e;
+
+  /* Only a private frame holds a page that might need to be
+     written out, so only it can fail, and it holds just one. */
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    if (!page_out (list_entry (e, struct page, frame_elem)))
+      return false;
+
+  list_init (&f->pages);
+  f->page_cnt = 0;
+  return true;
+}
+
+/* Evicts a frame's pages to make room for page P, and returns
+   the frame, locked and given to P.  Returns a null pointer if
+   no frame could be evicted, setting *BUSY to true if that was
+   because frames were locked by other threads, so that waiting
+   for one to be unlocked may help.  scan_lock must be held.
+
+   This is the clock algorithm.  The hand sweeps the frames in
+   order, giving each frame whose pages' accessed bits are set a
+   second chance by clearing the bits, and evicting the first
+   frame whose bits are already clear.  Frames locked by other
+   threads, for paging or for I/O, are passed over.  Each
+   accessed bit that the hand clears was set by an access since
+   the hand last passed, so over many evictions the hand moves a
+   constant number of frames per eviction on average.  Two full
+   sweeps are enough to find a victim unless every frame is
+   locked. */
+static struct frame *
+evict_frame (struct page *p, bool *busy)
+{
+  size_t i;
+
+  *busy = false;
+  for (i = 0; i < frame_cnt * 2; i++)
+    {
+      struct frame *f = &frames[hand];
+      if (++hand >= frame_cnt)
+        hand = 0;
+
+      if (lock_held_by_current_thread (&f->lock))
+        continue;
+      if (!lock_try_acquire (&f->lock))
+        {
+          *busy = true;
+          continue;
+        }
+
+      if (f->page_cnt == 0)
+        {
+          /* Freed since it was last looked at.  It is still on
+             the free list, so take it off. */
+          list_remove (&f->free_elem);
+          attach_page (f, p);
+          return f;
+        }
+
+      if (accessed_recently (f))
+        {
+          lock_release (&f->lock);
+          continue;
+        }
+
+      /* Write the pages out without holding up other
+         allocations. */
+      lock_release (&scan_lock);
+      if (!evict_pages (f))
+        {
+          lock_release (&f->lock);
+          lock_acquire (&scan_lock);
+          cond_broadcast (&frame_unlocked, &scan_lock);
+          *busy = false;
+          return NULL;
+        }
+      lock_acquire (&scan_lock);
+
+      evict_cnt++;
+      unpublish (f);
+      attach_page (f, p);
+      return f;
+    }
+  return NULL;
+}
+
+/* Allocates a frame for page P and returns it locked, evicting
+   other pages if necessary.  Returns a null pointer if no frame
+   can be had.
+
+   If every frame that could be evicted is locked by another
+   thread, probably for I/O, waits until one is unlocked and
+   tries again. */
+struct frame *
+frame_alloc_and_lock (struct page *p)
+{
+  struct frame *f;
+
+  lock_acquire (&scan_lock);
+  for (;;)
+    {
+      bool busy;
+
+      f = alloc_free_frame (p);
+      if (f == NULL)
+        f = evict_frame (p, &busy);
+      if (f != NULL || !busy)
+        break;
+      cond_wait (&frame_unlocked, &scan_lock);
+    }
+  lock_release (&scan_lock);
+
+  ASSERT (f == NULL || lock_held_by_current_thread (&f->lock));
+  return f;
+}
+
+/* Unlocks frame F, which must be locked by the current thread,
+   and wakes up allocations waiting for a frame to be
+   unlocked. */
+static void
+unlock_frame (struct frame *f)
+{
+  lock_release (&f->lock);
+  lock_acquire (&scan_lock);
+  cond_broadcast (&frame_unlocked, &scan_lock);
+  lock_release (&scan_lock);
+}
+
+/* Sets the shared frame table key of frame F to the contents of
+   page P, which must be an unmodified page of a file or a page
+   of zeros.  All pages of zeros share a key, with a null
+   inode. */
+static void
+set_key (struct frame *f, const struct page *p)
+{
+  f->inode = p->file != NULL ? file_get_inode (p->file) : NULL;
+  f->offset = p->file_offset;
+  f->bytes = p->file_bytes;
+}
+
+/* Looks for a shared frame that holds exactly the data that page
+   P, which must be an unmodified page of a file or a page of
+   zeros, would start out with.  If there is one, gives it to P
+   as well and returns it locked.  Otherwise, returns a null
+   pointer. */
+struct frame *
+frame_share_and_lock (struct page *p)
+{
+  struct frame key;
+
+  set_key (&key, p);
+
+  for (;;)
+    {
+      struct hash_elem *e;
+      struct frame *f;
+
+      lock_acquire (&scan_lock);
+      e = hash_find (&shared_frames, &key.share_elem);
+      if (e == NULL)
+        {
+          lock_release (&scan_lock);
+          return NULL;
+        }
+      f = hash_entry (e, struct frame, share_elem);
+      if (lock_try_acquire (&f->lock))
+        {
+          lock_release (&scan_lock);
+          attach_page (f, p);
+          share_cnt++;
+          return f;
+        }
+      lock_release (&scan_lock);
+
+      /* Someone is using the frame, perhaps evicting it.  Wait
+         for them to finish, then look again. */
+      lock_acquire (&f->lock);
+      unlock_frame (f);
+    }
+}
+
+/* Enters frame F, which must be locked and hold just one page,
+   freshly read from that page's file or zeroed, into the shared frame
+   table, so that other processes can map it too.  If another
+   frame with the same data got there first, F stays private. */
+void
+frame_publish (struct frame *f)
+{
+  struct page *p;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  ASSERT (f->page_cnt == 1);
+
+  p = list_entry (list_front (&f->pages), struct page, frame_elem);
+  set_key (f, p);
+
+  lock_acquire (&scan_lock);
+  f->shared = hash_insert (&shared_frames, &f->share_elem) == NULL;
+  lock_release (&scan_lock);
+}
+
+/* Gives page P, whose frame must be locked and shared, a private
+   frame that it can write to, by copying the data if other pages
+   still use the shared frame.  Returns true if successful, with
+   P's new frame locked, false if no frame could be had. */
+bool
+frame_make_private (struct page *p)
+{
+  struct frame *old = p->frame;
+  struct frame *new;
+
+  ASSERT (lock_held_by_current_thread (&old->lock));
+  ASSERT (old->shared);
+
+  if (old->page_cnt == 1)
+    {
+      /* Nobody else uses it, so it can just stop being shared. */
+      lock_acquire (&scan_lock);
+      unpublish (old);
+      lock_release (&scan_lock);
+      return true;
+    }
+
+  /* Copy on write.  OLD stays locked, so it cannot be evicted
+     while the copy is made. */
+  list_remove (&p->frame_elem);
+  old->page_cnt--;
+  new = frame_alloc_and_lock (p);
+  if (new == NULL)
+    {
+      attach_page (old, p);
+      return false;
+    }
+  memcpy (new->base, old->base, PGSIZE);
+  unlock_frame (old);
+  return true;
+}
+
+/* Locks P's frame, if it has one, so that it cannot be evicted.
+   On return, P's frame is locked by the current thread, or P has
+   no frame. */
+void
+frame_lock (struct page *p)
+{
+  struct frame *f = p->frame;
+
+  if (f != NULL)
+    {
+      lock_acquire (&f->lock);
+      if (f != p->frame)
+        {
+          /* Evicted while we waited for the lock. */
+          unlock_frame (f);
+          ASSERT (p->frame == NULL);
+        }
+    }
+}
+
+/* Removes page P from frame F, which must be locked by the
+   current thread, and unlocks F.  If no other page uses F, it
+   becomes free. */
+void
+frame_release (struct frame *f, struct page *p)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  lock_acquire (&scan_lock);
+  list_remove (&p->frame_elem);
+  if (--f->page_cnt == 0)
+    {
+      unpublish (f);
+      list_push_back (&free_frames, &f->free_elem);
+    }
+  p->frame = NULL;
+  lock_release (&f->lock);
+  cond_broadcast (&frame_unlocked, &scan_lock);
+  lock_release (&scan_lock);
+}
+
+/* Unlocks frame F, allowing it to be evicted.  F must be locked
+   by the current thread. */
+void
+frame_unlock (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  unlock_frame (f);
+}
+
+/* Returns a hash value for the shared frame that E refers to. */
+static unsigned
+share_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, share_elem);
+  return hash_bytes (&f->inode, sizeof f->inode) ^ hash_int (f->offset);
+}
+
+/* Returns true if shared frame A precedes shared frame B. */
+static bool
+share_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, share_elem);
+  const struct frame *b = hash_entry (b_, struct frame, share_elem);
+
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  else if (a->offset != b->offset)
+    return a->offset < b->offset;
+  else
+    return a->bytes < b->bytes;
+}
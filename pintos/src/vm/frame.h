@@ -0,0 +1,52 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+struct page;
+
+/* A physical frame of user memory.
+
+   A frame normally holds one process's page.  A frame holding
+   an unmodified page of an executable may instead be shared:
+   entered in a table keyed by the inode and the range of it that
+   the frame holds, so that every process running the same
+   executable maps the same frame for that page.  Likewise, one
+   shared frame of zeros backs every page of zeros that has only
+   been read.  Shared frames are always mapped read-only; a
+   process that writes to one gets a private copy (see
+   frame_make_private()). */
+struct frame
+  {
+    struct lock lock;           /* Held while the frame is in use. */
+    void *base;                 /* Kernel virtual base address. */
+    struct list pages;          /* Pages using the frame, if any. */
+    size_t page_cnt;            /* Number of pages in PAGES. */
+    struct list_elem free_elem; /* Element in free list, if free. */
+
+    /* Shared frames only. */
+    bool shared;                /* In the shared frame table? */
+    struct hash_elem share_elem; /* Element in shared frame table. */
+    struct inode *inode;        /* Source of data, null for zeros. */
+    off_t offset;               /* Offset in inode. */
+    off_t bytes;                /* Bytes from inode, rest zeroed. */
+  };
+
+void frame_init (void);
+void frame_print_stats (void);
+
+struct frame *frame_alloc_and_lock (struct page *);
+struct frame *frame_share_and_lock (struct page *);
+void frame_lock (struct page *);
+
+void frame_publish (struct frame *);
+bool frame_make_private (struct page *);
+
+void frame_release (struct frame *, struct page *);
+void frame_unlock (struct frame *);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,127 @@
+#include "vm/mmap.h"
+#include <round.h>
+#include "vm/page.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+
+static void unmap (struct mapping *);
+
+/* Maps FILE into the current process's address space starting
+   at ADDR, and returns the new mapping's id, or -1 on failure.
+   ADDR must be page-aligned and nonzero, FILE must not be empty,
+   and the pages it will occupy must not overlap any existing
+   page.  The mapping refers to its own copy of FILE, so it is
+   unaffected by closing FILE.
+
+   No data is read here.  Each page is read from the file when it
+   is first touched, and written back only if it was modified,
+   when it is evicted or unmapped. */
+int
+mmap_map (struct file *file, void *addr)
+{
+  struct thread *t = thread_current ();
+  struct mapping *m;
+  off_t length;
+  size_t i;
+
+  if (addr == NULL || pg_ofs (addr) != 0)
+    return -1;
+
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return -1;
+
+  lock_acquire (&filesys_lock);
+  m->file = file_reopen (file);
+  length = m->file != NULL ? file_length (m->file) : 0;
+  lock_release (&filesys_lock);
+  if (length == 0
+      || (uint8_t *) addr + length < (uint8_t *) addr
+      || !is_user_vaddr ((uint8_t *) addr + length - 1))
+    {
+      lock_acquire (&filesys_lock);
+      file_close (m->file);
+      lock_release (&filesys_lock);
+      free (m);
+      return -1;
+    }
+
+  m->id = t->next_mapping_id++;
+  m->base = addr;
+  m->page_cnt = 0;
+  list_push_front (&t->mappings, &m->elem);
+
+  for (i = 0; i < DIV_ROUND_UP ((size_t) length, PGSIZE); i++)
+    {
+      off_t ofs = i * PGSIZE;
+      struct page *p = page_allocate (m->base + ofs, false);
+      if (p == NULL)
+        {
+          unmap (m);
+          return -1;
+        }
+      p->private = false;
+      p->file = m->file;
+      p->file_offset = ofs;
+      p->file_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+      m->page_cnt++;
+    }
+  return m->id;
+}
+
+/* Unmaps the current process's mapping with the given ID,
+   writing back any pages that were changed.  Returns true if
+   successful, false if there is no such mapping. */
+bool
+mmap_unmap (int id)
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&t->mappings); e != list_end (&t->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->id == id)
+        {
+          unmap (m);
+          return true;
+        }
+    }
+  return false;
+}
+
+/* Unmaps all of the current process's mappings. */
+void
+mmap_exit (void)
+{
+  struct thread *t = thread_current ();
+
+  while (!list_empty (&t->mappings))
+    unmap (list_entry (list_front (&t->mappings), struct mapping, elem));
+}
+
+/* Removes mapping M, writing back its modified pages, and frees
+   it. */
+static void
+unmap (struct mapping *m)
+{
+  size_t i;
+
+  /* Unmap the whole range first, with one TLB invalidation,
+     instead of one for each page as it is freed.  The dirty bits
+     survive for page_deallocate() to see. */
+  list_remove (&m->elem);
+  pagedir_clear_pages (thread_current ()->pagedir, m->base, m->page_cnt);
+  for (i = 0; i < m->page_cnt; i++)
+    page_deallocate (m->base + i * PGSIZE);
+
+  lock_acquire (&filesys_lock);
+  file_close (m->file);
+  lock_release (&filesys_lock);
+  free (m);
+}
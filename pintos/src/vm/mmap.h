@@ -0,0 +1,24 @@
+#ifndef VM_MMAP_H
+#define VM_MMAP_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct file;
+
+/* A memory-mapped file. */
+struct mapping
+  {
+    struct list_elem elem;      /* Element in thread's `mappings'. */
+    int id;                     /* Mapping id. */
+    struct file *file;          /* File, reopened for the mapping. */
+    uint8_t *base;              /* Start of memory mapping. */
+    size_t page_cnt;            /* Number of pages mapped. */
+  };
+
+int mmap_map (struct file *, void *addr);
+bool mmap_unmap (int id);
+void mmap_exit (void);
+
+#endif /* vm/mmap.h */
@@ -0,0 +1,436 @@
+#include "vm/page.h"
+#include <stdio.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/swap.h"
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "userprog/syscall.h"
+
+/* Number of pages brought in from files and zero-filled, for
+   comparison with the size of the programs that were run. */
+static long long page_file_cnt;
+static long long page_zero_cnt;
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+
+/* Creates an empty supplemental page table for the current
+   process.  Returns true if successful, false if memory is
+   exhausted. */
+bool
+page_init (void)
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (t->pages == NULL);
+
+  t->pages = malloc (sizeof *t->pages);
+  if (t->pages == NULL)
+    return false;
+  if (!hash_init (t->pages, page_hash, page_less, NULL))
+    {
+      free (t->pages);
+      t->pages = NULL;
+      return false;
+    }
+  return true;
+}
+
+/* Frees a page, along with its frame and swap slot, first
+   writing it back to its file if it is a modified page of a
+   memory-mapped file. */
+static void
+destroy_page (struct hash_elem *e, void *aux UNUSED)
+{
+  struct page *p = hash_entry (e, struct page, hash_elem);
+
+  frame_lock (p);
+  if (p->frame != NULL)
+    {
+      struct frame *f = p->frame;
+
+      /* Changes to a memory-mapped file must not be lost. */
+      if (p->private)
+        pagedir_clear_page (p->thread->pagedir, p->addr);
+      else
+        page_out (p);
+      frame_release (f, p);
+    }
+  swap_free (p);
+  free (p);
+}
+
+/* Destroys the current process's supplemental page table,
+   freeing all of its frames and swap slots.  Must be called
+   while the process's page directory still exists. */
+void
+page_exit (void)
+{
+  struct thread *t = thread_current ();
+
+  if (t->pages != NULL)
+    {
+      hash_destroy (t->pages, destroy_page);
+      free (t->pages);
+      t->pages = NULL;
+    }
+}
+
+/* Prints paging statistics. */
+void
+page_print_stats (void)
+{
+  printf ("Paging: %lld pages read from files, %lld zero-filled\n",
+          page_file_cnt, page_zero_cnt);
+}
+
+/* Adds a page at user virtual address ADDR to the current
+   process's supplemental page table, with no backing file, and
+   returns it.  Returns a null pointer if there is already a page
+   at ADDR or if memory is exhausted. */
+struct page *
+page_allocate (void *addr, bool read_only)
+{
+  struct thread *t = thread_current ();
+  struct page *p = malloc (sizeof *p);
+
+  if (p == NULL)
+    return NULL;
+
+  p->addr = pg_round_down (addr);
+  p->read_only = read_only;
+  p->thread = t;
+  p->frame = NULL;
+  p->sector = (block_sector_t) -1;
+  p->file = NULL;
+  p->file_offset = 0;
+  p->file_bytes = 0;
+  p->private = true;
+
+  if (hash_insert (t->pages, &p->hash_elem) != NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  return p;
+}
+
+/* Removes the current process's page at ADDR, which must
+   exist, from its supplemental page table and frees it, writing
+   it back to its file first if it is a modified page of a
+   memory-mapped file. */
+void
+page_deallocate (void *addr)
+{
+  struct thread *t = thread_current ();
+  struct page key;
+  struct hash_elem *e;
+
+  key.addr = pg_round_down (addr);
+  e = hash_delete (t->pages, &key.hash_elem);
+  ASSERT (e != NULL);
+  destroy_page (e, NULL);
+}
+
+/* Returns the current process's page containing ADDR, or a
+   null pointer if there is none.
+
+   If ADDR looks like an access to the stack just below the
+   page that holds the bottom of the stack, adds a new stack page
+   for it instead.  An access counts as a stack access if it is
+   within STACK_MAX of PHYS_BASE and no more than 32 bytes below
+   the user stack pointer, since PUSHA checks the lowest address
+   it will write before moving the stack pointer.  The user stack
+   pointer is the one saved on entry to the kernel, so this also
+   works for accesses that the kernel makes on the process's
+   behalf during a system call. */
+static struct page *
+page_for_addr (const void *addr)
+{
+  struct thread *t = thread_current ();
+  struct page key;
+  struct hash_elem *e;
+
+  if (t->pages == NULL || !is_user_vaddr (addr))
+    return NULL;
+
+  key.addr = pg_round_down (addr);
+  e = hash_find (t->pages, &key.hash_elem);
+  if (e != NULL)
+    return hash_entry (e, struct page, hash_elem);
+
+  if ((uint8_t *) addr >= (uint8_t *) PHYS_BASE - STACK_MAX
+      && (uint8_t *) addr >= (uint8_t *) t->user_esp - 32)
+    return page_allocate ((void *) addr, false);
+
+  return NULL;
+}
+
+/* Gives page P a frame and fills it from swap, from P's file,
+   or with zeros.  Returns true if successful, with P's frame
+   locked, or false on failure.
+
+   An unmodified page of an executable, whose contents are just
+   what its file holds, shares its frame with every other process
+   that has the same page of the same executable in memory, and
+   an untouched page of zeros shares the frame of zeros, unless
+   WILL_WRITE is true, in which case it would only have to be
+   copied right away. */
+static bool
+do_page_in (struct page *p, bool will_write)
+{
+  bool shareable = (!will_write && p->private
+                    && p->sector == (block_sector_t) -1);
+
+  if (shareable && frame_share_and_lock (p) != NULL)
+    return true;
+
+  if (frame_alloc_and_lock (p) == NULL)
+    return false;
+
+  if (p->sector != (block_sector_t) -1)
+    swap_in (p);
+  else if (p->file != NULL)
+    {
+      off_t read_bytes;
+
+      lock_acquire (&filesys_lock);
+      read_bytes = file_read_at (p->file, p->frame->base, p->file_bytes,
+                                 p->file_offset);
+      lock_release (&filesys_lock);
+      if (read_bytes != p->file_bytes)
+        {
+          frame_release (p->frame, p);
+          return false;
+        }
+      memset ((uint8_t *) p->frame->base + read_bytes, 0,
+              PGSIZE - read_bytes);
+      page_file_cnt++;
+      if (shareable)
+        frame_publish (p->frame);
+    }
+  else
+    {
+      memset (p->frame->base, 0, PGSIZE);
+      page_zero_cnt++;
+      if (shareable)
+        frame_publish (p->frame);
+    }
+  return true;
+}
+
+/* Brings page P into a locked frame, if it is not in one
+   already, and maps it.  A page in a shared frame is mapped
+   read-only even if P is writable, so that the first write to
+   it faults and gets a private copy.  WILL_WRITE is true if the
+   page is about to be written.  Returns true if successful, with
+   P's frame locked, or false on failure. */
+static bool
+lock_in (struct page *p, bool will_write)
+{
+  frame_lock (p);
+  if (p->frame != NULL)
+    return true;
+
+  if (!do_page_in (p, will_write))
+    return false;
+  if (!pagedir_set_page (p->thread->pagedir, p->addr, p->frame->base,
+                         !p->read_only && !p->frame->shared))
+    {
+      frame_release (p->frame, p);
+      return false;
+    }
+  return true;
+}
+
+/* Gives writable page P, whose frame must be locked, a frame of
+   its own, if its frame is shared, and maps it writable.
+   Returns true if successful, false if no frame could be had. */
+static bool
+make_writable (struct page *p)
+{
+  ASSERT (!p->read_only);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  if (!p->frame->shared)
+    return true;
+  if (!frame_make_private (p))
+    return false;
+
+  /* The mapping must change even if the frame did not, and
+     changing the mapping of a present page requires flushing
+     the TLB, which pagedir_clear_page() does. */
+  pagedir_clear_page (p->thread->pagedir, p->addr);
+  return pagedir_set_page (p->thread->pagedir, p->addr, p->frame->base,
+                           true);
+}
+
+/* Faults in the page containing FAULT_ADDR, which was not
+   present in the current process's page directory.  WRITE is
+   true if the fault was caused by a write.  Returns true if
+   successful, false if FAULT_ADDR is not part of the process's
+   address space or the page cannot be brought in. */
+bool
+page_in (void *fault_addr, bool write)
+{
+  struct page *p = page_for_addr (fault_addr);
+
+  if (p == NULL || !lock_in (p, write))
+    return false;
+  frame_unlock (p->frame);
+  return true;
+}
+
+/* Handles a write to the current process's page containing
+   FAULT_ADDR, which was present but mapped read-only.  If the
+   page is writable and was mapped read-only only because its
+   frame was shared, copies it into a private frame and maps that
+   writable.  Returns true if the write may be retried, false if
+   it was a genuine protection violation. */
+bool
+page_copy_on_write (void *fault_addr)
+{
+  struct page *p = page_for_addr (fault_addr);
+  bool success;
+
+  if (p == NULL || p->read_only)
+    return false;
+
+  frame_lock (p);
+  if (p->frame == NULL)
+    {
+      /* Evicted since the fault.  Retrying will fault it back
+         in. */
+      return true;
+    }
+  success = make_writable (p);
+  frame_unlock (p->frame);
+  return success;
+}
+
+/* Evicts page P from its frame, which must be locked by the
+   current thread, writing it to swap if its contents cannot be
+   recovered otherwise.  Returns true if successful, false if
+   swap is full.  Afterward P has no frame, but the frame is
+   still locked. */
+bool
+page_out (struct page *p)
+{
+  bool dirty;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  /* Unmap the page first, so that the process faults, and waits
+     for the frame lock, instead of writing to the page while it
+     is written out.  The dirty bit must be read after that. */
+  pagedir_clear_page (p->thread->pagedir, p->addr);
+  dirty = pagedir_is_dirty (p->thread->pagedir, p->addr);
+
+  /* A clean page of a file can just be read in again, and a
+     page in a shared frame is never modified. */
+  if ((p->file != NULL && !dirty) || p->frame->shared)
+    {
+      p->frame = NULL;
+      return true;
+    }
+
+  /* A modified page of a memory-mapped file goes back to it. */
+  if (!p->private)
+    {
+      lock_acquire (&filesys_lock);
+      file_write_at (p->file, p->frame->base, p->file_bytes,
+                     p->file_offset);
+      lock_release (&filesys_lock);
+      p->frame = NULL;
+      return true;
+    }
+
+  if (!swap_out (p))
+    {
+      pagedir_set_page (p->thread->pagedir, p->addr, p->frame->base,
+                        !p->read_only);
+      pagedir_set_dirty (p->thread->pagedir, p->addr, dirty);
+      return false;
+    }
+  p->frame = NULL;
+  return true;
+}
+
+/* Returns true if page P, which must have a locked frame, has
+   been accessed since the last call, and clears its accessed
+   bit. */
+bool
+page_accessed_recently (struct page *p)
+{
+  bool accessed;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  accessed = pagedir_is_accessed (p->thread->pagedir, p->addr);
+  if (accessed)
+    pagedir_set_accessed (p->thread->pagedir, p->addr, false);
+  return accessed;
+}
+
+/* Brings in the current process's page containing ADDR, if
+   necessary, and locks it into its frame, so that the kernel can
+   access it without faulting.  Fails if ADDR is not part of the
+   process's address space, or if WILL_WRITE is true and the page
+   is read-only.  Returns true if successful, false on failure. */
+bool
+page_lock (const void *addr, bool will_write)
+{
+  struct page *p = page_for_addr (addr);
+
+  if (p == NULL || (p->read_only && will_write))
+    return false;
+  if (!lock_in (p, will_write))
+    return false;
+
+  /* A kernel write to a read-only mapping faults like a user one
+     (CR0.WP is set), but a copy-on-write fault here would have to
+     lock the frame that we already hold locked, so a shared frame
+     must be copied now instead. */
+  if (will_write && !make_writable (p))
+    {
+      frame_unlock (p->frame);
+      return false;
+    }
+  return true;
+}
+
+/* Unlocks the page containing ADDR, which must have been locked
+   with page_lock(). */
+void
+page_unlock (const void *addr)
+{
+  struct page *p = page_for_addr (addr);
+
+  ASSERT (p != NULL);
+  frame_unlock (p->frame);
+}
+
+/* Returns a hash value for the page that E refers to. */
+static unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, hash_elem);
+  return ((uintptr_t) p->addr) >> PGBITS;
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+
+  return a->addr < b->addr;
+}
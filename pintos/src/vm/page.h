@@ -0,0 +1,60 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <stdbool.h>
+#include "devices/block.h"
+#include "filesys/off_t.h"
+
+/* A virtual page in a user process's supplemental page table.
+
+   Every page of a process's address space has one of these,
+   describing where its contents are when it is not in memory:
+   in a swap slot, in a range of a file, or nowhere, for a page
+   that starts out zeroed. */
+struct page
+  {
+    /* Immutable members. */
+    void *addr;                 /* User virtual address. */
+    bool read_only;             /* Read-only page? */
+    struct thread *thread;      /* Owning thread. */
+    struct hash_elem hash_elem; /* Element in thread's `pages' table. */
+
+    /* Changed only while the frame is locked, or, if there is no
+       frame, only by the owning thread. */
+    struct frame *frame;        /* Frame holding the page, or null. */
+    struct list_elem frame_elem; /* Element in frame's `pages' list. */
+    block_sector_t sector;      /* First swap sector, or -1. */
+
+    /* Backing file, or null.  The first FILE_BYTES bytes of the
+       page come from FILE starting at FILE_OFFSET, and the rest
+       of the page is zeroed.  A page with neither a file nor a
+       swap slot is zero-filled.  Changes to a private page, such
+       as one of an executable's data segment, go to swap;
+       changes to a shared page, that is, a page of a memory
+       mapped file, are written back to the file. */
+    struct file *file;          /* File. */
+    off_t file_offset;          /* Offset in file. */
+    off_t file_bytes;           /* Bytes to read/write, 0...PGSIZE. */
+    bool private;               /* False to write back to file. */
+  };
+
+/* Maximum size of a process's stack, which grows down from
+   PHYS_BASE as it is used. */
+#define STACK_MAX (8 * 1024 * 1024)
+
+bool page_init (void);
+void page_exit (void);
+void page_print_stats (void);
+
+struct page *page_allocate (void *addr, bool read_only);
+void page_deallocate (void *addr);
+bool page_in (void *fault_addr, bool write);
+bool page_copy_on_write (void *fault_addr);
+bool page_out (struct page *);
+bool page_accessed_recently (struct page *);
+
+bool page_lock (const void *addr, bool will_write);
+void page_unlock (const void *addr);
+
+#endif /* vm/page.h */
@@ -0,0 +1,97 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <stdio.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "devices/block.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* The swap device. */
+static struct block *swap_device;
+
+/* Used swap slots, one bit per page-sized slot. */
+static struct bitmap *swap_bitmap;
+
+/* Protects swap_bitmap. */
+static struct lock swap_lock;
+
+/* Number of sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Sets up swap. */
+void
+swap_init (void)
+{
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device == NULL)
+    {
+      printf ("no swap device--swap disabled\n");
+      swap_bitmap = bitmap_create (0);
+    }
+  else
+    swap_bitmap = bitmap_create (block_size (swap_device) / PAGE_SECTORS);
+  if (swap_bitmap == NULL)
+    PANIC ("couldn't create swap bitmap");
+  lock_init (&swap_lock);
+}
+
+/* Swaps in page P, which must have a locked frame and be in
+   swap, and frees its swap slot. */
+void
+swap_in (struct page *p)
+{
+  size_t i;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+  ASSERT (p->sector != (block_sector_t) -1);
+
+  for (i = 0; i < PAGE_SECTORS; i++)
+    block_read (swap_device, p->sector + i,
+                (uint8_t *) p->frame->base + i * BLOCK_SECTOR_SIZE);
+  swap_free (p);
+}
+
+/* Swaps out page P, which must have a locked frame.  Returns
+   true if successful, false if swap is full. */
+bool
+swap_out (struct page *p)
+{
+  size_t slot;
+  size_t i;
+
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  lock_acquire (&swap_lock);
+  slot = bitmap_scan_and_flip (swap_bitmap, 0, 1, false);
+  lock_release (&swap_lock);
+  if (slot == BITMAP_ERROR)
+    return false;
+
+  p->sector = slot * PAGE_SECTORS;
+  for (i = 0; i < PAGE_SECTORS; i++)
+    block_write (swap_device, p->sector + i,
+                 (uint8_t *) p->frame->base + i * BLOCK_SECTOR_SIZE);
+
+  /* The page's contents are no longer those of its file. */
+  p->file = NULL;
+  p->file_offset = 0;
+  p->file_bytes = 0;
+  return true;
+}
+
+/* Releases page P's swap slot, if it has one. */
+void
+swap_free (struct page *p)
+{
+  if (p->sector == (block_sector_t) -1)
+    return;
+
+  lock_acquire (&swap_lock);
+  bitmap_reset (swap_bitmap, p->sector / PAGE_SECTORS);
+  lock_release (&swap_lock);
+  p->sector = (block_sector_t) -1;
+}